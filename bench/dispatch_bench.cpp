@@ -0,0 +1,114 @@
+#include "chip8.h"
+#include "jit_x64.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+/*
+Throughput comparison of the execution paths on the same ROMs:
+- nested: the original two-level tables (Chip8::CycleNested)
+- cached: decode cache + flat dispatch table (Chip8::Cycle)
+- blocks: the basic-block engine (Chip8::Run with Engine::BasicBlock)
+- jit:    the x86-64 recompiler (Jit::Run)
+
+All machines are seeded identically so the final state can be compared to make
+sure every path really executed the same program. Idle-loop skipping is turned
+off so every cycle is actually dispatched.
+*/
+
+static double RunNested(Chip8& chip8, long cycles)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (long i = 0; i < cycles; ++i)
+	{
+		chip8.CycleNested();
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+static double RunEngine(Chip8& chip8, Engine engine, long cycles)
+{
+	chip8.engine = engine;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	chip8.Run(static_cast<uint32_t>(cycles));
+
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+static double RunJit(Chip8& chip8, long cycles)
+{
+	Jit jit(chip8);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	jit.Run(static_cast<uint32_t>(cycles));
+
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+static bool SameState(Chip8 const& a, Chip8 const& b)
+{
+	return memcmp(a.registers, b.registers, sizeof(a.registers)) == 0
+		&& memcmp(a.memory, b.memory, sizeof(a.memory)) == 0
+		&& memcmp(a.video, b.video, sizeof(a.video)) == 0
+		&& a.index == b.index && a.pc == b.pc && a.sp == b.sp
+		&& a.delayTimer == b.delayTimer && a.soundTimer == b.soundTimer;
+}
+
+static void Report(char const* name, long cycles, double seconds, double baseline, Chip8 const& chip8, Chip8 const& reference)
+{
+	std::cout << "  " << name << cycles / seconds / 1e6 << " MIPS, "
+		<< baseline / seconds << "x"
+		<< (SameState(chip8, reference) ? "" : "  (STATE MISMATCH)") << "\n";
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <Cycles> <ROM>...\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	long cycles = std::stol(argv[1]);
+
+	for (int arg = 2; arg < argc; ++arg)
+	{
+		Chip8 nested;
+		Chip8 cached;
+		Chip8 blocks;
+		Chip8 jit;
+		nested.LoadROM(argv[arg]);
+		cached.LoadROM(argv[arg]);
+		blocks.LoadROM(argv[arg]);
+		jit.LoadROM(argv[arg]);
+		nested.Seed(1);
+		cached.Seed(1);
+		blocks.Seed(1);
+		jit.Seed(1);
+		cached.skipIdle = false;
+		blocks.skipIdle = false;
+		jit.skipIdle = false;
+
+		double nestedSeconds = RunNested(nested, cycles);
+		double cachedSeconds = RunEngine(cached, Engine::Interpreter, cycles);
+		double blocksSeconds = RunEngine(blocks, Engine::BasicBlock, cycles);
+		double jitSeconds = RunJit(jit, cycles);
+
+		std::cout << argv[arg] << "\n";
+		Report("nested: ", cycles, nestedSeconds, nestedSeconds, nested, nested);
+		Report("cached: ", cycles, cachedSeconds, nestedSeconds, cached, nested);
+		Report("blocks: ", cycles, blocksSeconds, nestedSeconds, blocks, nested);
+		Report("jit:    ", cycles, jitSeconds, nestedSeconds, jit, nested);
+	}
+
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include "chip8.h"
+#include "jit_x64.h"
+#include <cstring>
+#include <iostream>
+
+/*
+Runs built-in ROMs on every engine and checks they all end in the same state, exits non-zero when one differs
+
+Each case is a ROM that once made an engine go wrong, kept so it cannot come back unnoticed. Idle-loop
+skipping stays on like in the frontends, the interpreter is the reference.
+*/
+
+struct Case
+{
+	char const* name;
+	uint16_t const* program; // loaded at START_ADDRESS
+	size_t programWords;
+	uint16_t const* subroutine; // loaded at 0x300
+	size_t subroutineWords;
+	uint32_t cycles;
+};
+
+// Stores over translated code that leave it unchanged, then one that changes it (the call at 0x202 becomes 6110)
+static const uint16_t partialInvalidation[] = {
+	0x6820, 0x2300, 0x78FF, 0x3800, 0x1202, 0x6077, 0x6101, 0x6200, 0x63EE, 0x64AB,
+	0x6500, 0xA302, 0xF555, 0x6110, 0xF155, 0x2300, 0x2300, 0x2300, 0x1224
+};
+
+static const uint16_t partialInvalidationSubroutine[] = {0x7601, 0x7701, 0x00EE};
+
+static const Case cases[] = {
+	{"overwrite after partial invalidation", partialInvalidation, sizeof(partialInvalidation) / 2,
+		partialInvalidationSubroutine, sizeof(partialInvalidationSubroutine) / 2, 2000}
+};
+
+static void Load(Chip8& chip8, uint16_t address, uint16_t const* words, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		chip8.memory[address + 2 * i] = words[i] >> 8;
+		chip8.memory[address + 2 * i + 1] = words[i] & 0xFF;
+	}
+
+	chip8.InvalidateDecodeCache(address, static_cast<uint16_t>(2 * count));
+}
+
+int main()
+{
+	int failures = 0;
+
+	for (Case const& test : cases)
+	{
+		static Chip8 machines[3];
+		char const* names[3] = {"interpreter", "block", "jit"};
+
+		for (Chip8& chip8 : machines)
+		{
+			chip8 = Chip8();
+			Load(chip8, START_ADDRESS, test.program, test.programWords);
+			Load(chip8, 0x300, test.subroutine, test.subroutineWords);
+		}
+
+		machines[0].Run(test.cycles);
+
+		machines[1].engine = Engine::BasicBlock;
+		machines[1].Run(test.cycles);
+
+		Jit jit(machines[2]);
+		jit.Run(test.cycles);
+
+		for (int engine = 1; engine < 3; ++engine)
+		{
+			bool same = memcmp(&machines[engine].State(), &machines[0].State(), CHIP8_STATE_BYTES) == 0;
+			failures += !same;
+
+			std::cout << test.name << ", " << names[engine] << ": " << (same ? "ok" : "STATE MISMATCH") << "\n";
+		}
+	}
+
+	return failures == 0 ? 0 : 1;
+}
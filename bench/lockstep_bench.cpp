@@ -0,0 +1,112 @@
+#include "chip8.h"
+#include "lockstep.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+/*
+Aggregate throughput of the lockstep engine (src/lockstep.cpp) against one Chip8::Cycle() per instance
+
+Every ROM runs on 8, 16 and 32 lanes. Each lane gets its own seed, and its own keys go down now and then,
+so lanes that depend on Cxkk or the keypad really diverge. The same lanes also run as separate Chip8s
+calling Cycle(), that is the baseline, and every lane must end in exactly the same state as its Chip8.
+groups/cycle is how many pc groups a cycle took on average, 1 when the lanes never diverged.
+*/
+
+static const uint32_t CYCLES_PER_FRAME = 10;
+
+// Lane l holds key (frame + l) % 16 for the first few frames of every 30
+static void PressKeys(uint8_t* keypad, unsigned int lane, long frame)
+{
+	memset(keypad, 0, 16);
+
+	if (frame % 30 < 4)
+	{
+		keypad[(frame / 30 + lane) % 16] = 1;
+	}
+}
+
+template <unsigned int Lanes>
+static void Compare(char const* rom, long frames)
+{
+	Chip8 prototype;
+	prototype.LoadROM(rom);
+	prototype.instructionsPerSecond = CYCLES_PER_FRAME * 60;
+
+	std::unique_ptr<Lockstep<Lanes>> lockstep(new Lockstep<Lanes>(prototype));
+	static Chip8 machines[Lanes];
+
+	for (unsigned int lane = 0; lane < Lanes; ++lane)
+	{
+		machines[lane].SetState(prototype.State());
+		machines[lane].Seed(lane);
+		lockstep->Lane(lane).Seed(lane);
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (long frame = 0; frame < frames; ++frame)
+	{
+		for (unsigned int lane = 0; lane < Lanes; ++lane)
+		{
+			PressKeys(machines[lane].keypad, lane, frame);
+
+			for (uint32_t cycle = 0; cycle < CYCLES_PER_FRAME; ++cycle)
+			{
+				machines[lane].Cycle();
+			}
+		}
+	}
+
+	auto middle = std::chrono::high_resolution_clock::now();
+
+	for (long frame = 0; frame < frames; ++frame)
+	{
+		for (unsigned int lane = 0; lane < Lanes; ++lane)
+		{
+			PressKeys(lockstep->Keypad(lane), lane, frame);
+		}
+
+		lockstep->Run(CYCLES_PER_FRAME);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	double cycleSeconds = std::chrono::duration<double>(middle - start).count();
+	double lockstepSeconds = std::chrono::duration<double>(end - middle).count();
+	double instructions = static_cast<double>(frames) * CYCLES_PER_FRAME * Lanes;
+	bool same = true;
+
+	for (unsigned int lane = 0; lane < Lanes; ++lane)
+	{
+		same = same && memcmp(&machines[lane].State(), &lockstep->Lane(lane).State(), CHIP8_STATE_BYTES) == 0;
+	}
+
+	std::cout << "  " << Lanes << (Lanes < 10 ? " lanes:  " : " lanes: ")
+		<< instructions / cycleSeconds / 1e6 << " -> " << instructions / lockstepSeconds / 1e6 << " MIPS, "
+		<< cycleSeconds / lockstepSeconds << "x, "
+		<< static_cast<double>(lockstep->groups) / (frames * CYCLES_PER_FRAME) << " groups/cycle"
+		<< (same ? "" : "  (STATE MISMATCH)") << "\n";
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <Frames> <ROM>...\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	long frames = std::stol(argv[1]);
+
+	for (int arg = 2; arg < argc; ++arg)
+	{
+		std::cout << argv[arg] << "\n";
+		Compare<8>(argv[arg], frames);
+		Compare<16>(argv[arg], frames);
+		Compare<32>(argv[arg], frames);
+	}
+
+	return 0;
+}
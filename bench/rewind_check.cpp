@@ -0,0 +1,78 @@
+#include "chip8.h"
+#include "rewind.h"
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+/*
+Pushes frames into a small rewind ring and steps back through all of them, exits non-zero when a frame does
+not come back exactly or the ring holds more than its capacity
+
+Each case is a run of delta sizes that once made the ring go wrong, kept so it cannot come back unnoticed.
+Frame n overwrites the first bytes of the ROM area with n, so its delta is just one literal of those bytes.
+*/
+
+struct Case
+{
+	char const* name;
+	size_t capacity;
+	std::vector<size_t> deltas; // encoded bytes of each frame's delta
+};
+
+static const Case cases[] = {
+	// The fourth delta wraps past an old entry at the end of the ring that is never dropped
+	{"wrap past the oldest entry", 1000, {960, 30, 400, 400, 150, 100}},
+	{"exact fit then wrap", 1000, {500, 500, 500, 30, 30, 900}}
+};
+
+// Bytes to change for a delta of the given size: varint gap (2 bytes to the ROM area), varint length, literal
+static size_t Changed(size_t delta)
+{
+	return delta - (delta - 3 < 128 ? 3 : 4);
+}
+
+int main()
+{
+	int failures = 0;
+
+	for (Case const& test : cases)
+	{
+		static Chip8 chip8;
+		chip8 = Chip8();
+
+		Rewind rewind(test.capacity, 1000);
+		std::vector<std::vector<uint8_t>> frames;
+		bool ok = true;
+
+		for (size_t frame = 0; frame <= test.deltas.size(); ++frame)
+		{
+			if (frame > 0)
+			{
+				memset(&chip8.memory[START_ADDRESS], static_cast<int>(frame), Changed(test.deltas[frame - 1]));
+			}
+
+			uint8_t const* state = reinterpret_cast<uint8_t const*>(&chip8.State());
+			frames.push_back(std::vector<uint8_t>(state, state + CHIP8_STATE_BYTES));
+			rewind.Push(chip8);
+
+			ok &= rewind.BytesUsed() <= rewind.Capacity();
+		}
+
+		// Whatever is left of the history has to lead back through the frames in order
+		uint32_t kept = rewind.Frames();
+
+		for (uint32_t back = 1; back <= kept; ++back)
+		{
+			rewind.StepBack(chip8);
+			std::vector<uint8_t> const& expected = frames[frames.size() - 1 - back];
+			ok &= memcmp(&chip8.State(), expected.data(), CHIP8_STATE_BYTES) == 0;
+		}
+
+		failures += !ok;
+
+		std::cout << test.name << ": " << (ok ? "ok" : "WRONG FRAME OR OVERFULL RING") << " (" << kept
+			<< " frames kept)\n";
+	}
+
+	return failures == 0 ? 0 : 1;
+}
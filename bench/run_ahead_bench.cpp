@@ -0,0 +1,141 @@
+#include "chip8.h"
+#include "jit_x64.h"
+#include "run_ahead.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+/*
+Cost of run-ahead (src/run_ahead.cpp) per presented frame:
+- clone:  one snapshot + RestoreState() of a running machine, the fixed price of run-ahead
+- ahead N: a frame with N frames of run-ahead, against the same frame without
+
+Every run gets the same seed and the same key presses, the final machine state is compared with the run
+without run-ahead, since run-ahead must never change what the real frames do. Idle-loop skipping stays on
+like in the front end, so the numbers are what a player's machine pays.
+*/
+
+static const uint32_t MAX_AHEAD = 3;
+
+// A key goes down for a few frames now and then, so ROMs that wait for input keep moving
+static void PressKeys(Chip8& chip8, long frame)
+{
+	memset(chip8.keypad, 0, sizeof(chip8.keypad));
+
+	if (frame % 40 < 6)
+	{
+		chip8.keypad[(frame / 40) % 16] = 1;
+	}
+}
+
+template <typename F>
+static double Time(F f)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	f();
+
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+static double RunFrames(char const* rom, bool useJit, uint32_t aheadFrames, long frames, uint32_t cyclesPerFrame,
+	Chip8& chip8)
+{
+	chip8.LoadROM(rom);
+	chip8.Seed(1);
+	chip8.instructionsPerSecond = cyclesPerFrame * 60;
+
+	std::unique_ptr<Jit> jit;
+
+	if (useJit)
+	{
+		jit.reset(new Jit(chip8));
+	}
+
+	RunAhead runAhead(chip8, jit.get(), aheadFrames);
+	static uint32_t pixels[VIDEO_WIDTH * VIDEO_HEIGHT];
+
+	return Time([&]()
+	{
+		for (long frame = 0; frame < frames; ++frame)
+		{
+			PressKeys(chip8, frame);
+			runAhead.Frame(cyclesPerFrame, pixels);
+		}
+	});
+}
+
+static double TimeClone(char const* rom, long frames, uint32_t cyclesPerFrame)
+{
+	Chip8 chip8;
+	chip8.LoadROM(rom);
+	chip8.Seed(1);
+	chip8.instructionsPerSecond = cyclesPerFrame * 60;
+
+	alignas(64) static uint8_t snapshot[CHIP8_STATE_BYTES];
+	double seconds = 0.0;
+
+	// Clone the machine as it is at every frame of a real run, the frames in between are not timed
+	for (long frame = 0; frame < frames; ++frame)
+	{
+		PressKeys(chip8, frame);
+		chip8.Run(cyclesPerFrame);
+
+		seconds += Time([&]()
+		{
+			memcpy(snapshot, &chip8.State(), CHIP8_STATE_BYTES);
+			chip8.RestoreState(snapshot);
+		});
+	}
+
+	return seconds;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		std::cerr << "Usage: " << argv[0] << " <Frames> <CyclesPerFrame> <ROM>...\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	long frames = std::stol(argv[1]);
+	uint32_t cyclesPerFrame = std::stoul(argv[2]);
+
+	if (frames <= 0 || cyclesPerFrame == 0)
+	{
+		std::cerr << "Frames and CyclesPerFrame must be at least 1\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	for (int arg = 3; arg < argc; ++arg)
+	{
+		std::cout << argv[arg] << "\n";
+		std::cout << "  clone:    " << TimeClone(argv[arg], frames, cyclesPerFrame) / frames * 1e9 << " ns\n";
+
+		for (int useJit = 0; useJit <= CHIP8_JIT_AVAILABLE; ++useJit)
+		{
+			Chip8 reference;
+			double baseline = RunFrames(argv[arg], useJit != 0, 0, frames, cyclesPerFrame, reference);
+
+			std::cout << "  " << (useJit ? "jit" : "interpreter") << "\n";
+			std::cout << "    ahead 0: " << baseline / frames * 1e6 << " us/frame\n";
+
+			for (uint32_t ahead = 1; ahead <= MAX_AHEAD; ++ahead)
+			{
+				Chip8 chip8;
+				double seconds = RunFrames(argv[arg], useJit != 0, ahead, frames, cyclesPerFrame, chip8);
+				bool same = memcmp(&chip8.State(), &reference.State(), CHIP8_STATE_BYTES) == 0;
+
+				std::cout << "    ahead " << ahead << ": " << seconds / frames * 1e6 << " us/frame, +"
+					<< (seconds - baseline) / frames * 1e6 << " us"
+					<< (same ? "" : "  (STATE MISMATCH)") << "\n";
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,153 @@
+#include "chip8.h"
+#include "shared_rom_pool.h"
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+/*
+RAM per instance of the shared ROM pool (src/shared_rom_pool.cpp) against one plain Chip8 per instance
+
+Every instance gets its own seed and its own keys now and then, and runs the given frames. A plain Chip8
+runs the same frames next to it, every instance must end in exactly its state. Private is what an instance
+owns, shared is what it maps from the one image the whole pool shares.
+
+Before the given ROMs, a built-in one that only ever writes registers runs with idle skipping on (the default),
+each of its instances must own exactly one page, the state page; exits non-zero when one owns more.
+*/
+
+static const uint32_t CYCLES_PER_FRAME = 10;
+
+// Instance i holds key (frame / 30 + i) % 16 for the first few frames of every 30
+static void PressKeys(uint8_t* keypad, size_t instance, long frame)
+{
+	memset(keypad, 0, 16);
+
+	if (frame % 30 < 4)
+	{
+		keypad[(frame / 30 + instance) % 16] = 1;
+	}
+}
+
+// V0 += 1, V1 = V0, back to the start: touches nothing outside the registers
+static const uint8_t registersOnly[] = {0x70, 0x01, 0x81, 0x00, 0x12, 0x00};
+
+// False when an instance owns more than its state page, true as well when residency cannot be read
+static bool CheckOnePage()
+{
+	static Chip8 prototype;
+	memcpy(&prototype.memory[START_ADDRESS], registersOnly, sizeof(registersOnly));
+	prototype.InvalidateDecodeCache(START_ADDRESS, sizeof(registersOnly));
+	prototype.instructionsPerSecond = CYCLES_PER_FRAME * 60;
+
+	size_t pageBytes = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	SharedRomPool pool(prototype, 16);
+	bool onePage = true;
+
+	for (size_t instance = 0; instance < pool.Size(); ++instance)
+	{
+		Chip8& chip8 = pool.Instance(instance);
+
+		for (long frame = 0; frame < 600; ++frame)
+		{
+			PressKeys(chip8.keypad, instance, frame);
+			chip8.Run(CYCLES_PER_FRAME);
+		}
+
+		Residency residency;
+
+		if (!pool.Resident(instance, residency))
+		{
+			return true;
+		}
+
+		onePage &= residency.privateBytes == pageBytes;
+	}
+
+	std::cout << "registers only, skipIdle on: " << (onePage ? "one private page each" : "MORE THAN ONE PRIVATE PAGE")
+		<< "\n";
+
+	return onePage;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		std::cerr << "Usage: " << argv[0] << " <Instances> <Frames> <ROM>...\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	size_t instances = std::stoul(argv[1]);
+	long frames = std::stol(argv[2]);
+	bool onePage = CheckOnePage();
+
+	for (int arg = 3; arg < argc; ++arg)
+	{
+		Chip8 prototype;
+		prototype.LoadROM(argv[arg]);
+		prototype.instructionsPerSecond = CYCLES_PER_FRAME * 60;
+
+		SharedRomPool pool(prototype, instances);
+		size_t mismatches = 0;
+
+		for (size_t instance = 0; instance < instances; ++instance)
+		{
+			Chip8& chip8 = pool.Instance(instance);
+			static Chip8 plain;
+			plain.SetState(prototype.State());
+			chip8.Seed(instance);
+			plain.Seed(instance);
+
+			for (long frame = 0; frame < frames; ++frame)
+			{
+				PressKeys(chip8.keypad, instance, frame);
+				PressKeys(plain.keypad, instance, frame);
+				chip8.Run(CYCLES_PER_FRAME);
+				plain.Run(CYCLES_PER_FRAME);
+			}
+
+			mismatches += memcmp(&chip8.State(), &plain.State(), CHIP8_STATE_BYTES) != 0;
+		}
+
+		Residency total = {};
+		bool measured = true;
+
+		for (size_t instance = 0; instance < instances && measured; ++instance)
+		{
+			Residency residency;
+			measured = pool.Resident(instance, residency);
+			total.privateBytes += residency.privateBytes;
+			total.sharedBytes += residency.sharedBytes;
+		}
+
+		std::cout << argv[arg] << "\n  " << instances << " instances, plain Chip8: " << sizeof(Chip8) / 1024.0
+			<< " KB each, " << instances * sizeof(Chip8) / 1048576.0 << " MB\n";
+
+		if (measured)
+		{
+			double privateKB = static_cast<double>(total.privateBytes) / instances / 1024;
+
+			std::cout << "  pool: " << privateKB << " KB private + "
+				<< static_cast<double>(total.sharedBytes) / instances / 1024 << " KB shared each, "
+				<< (static_cast<double>(total.privateBytes) + pool.SlotBytes()) / 1048576.0 << " MB with the image, "
+				<< sizeof(Chip8) / 1024.0 / privateKB << "x denser";
+		}
+		else
+		{
+			std::cout << "  pool: /proc/self/pagemap not readable, no residency";
+		}
+
+		std::cout << (mismatches ? "  (STATE MISMATCH)" : "") << "\n";
+
+		pool.Reset(0);
+		Residency reset;
+
+		if (pool.Resident(0, reset) && memcmp(&pool.Instance(0).State(), &prototype.State(), CHIP8_STATE_BYTES) == 0)
+		{
+			std::cout << "  after Reset(0): " << reset.privateBytes / 1024 << " KB private\n";
+		}
+	}
+
+	return onePage ? 0 : 1;
+}
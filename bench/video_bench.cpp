@@ -0,0 +1,152 @@
+#include "video_simd.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+Microbenchmark of the framebuffer kernels in src/video_simd.cpp:
+- draw:   Dxyn sprites of random height and position, collision included
+- clear:  00E0
+- expand: 64x32 bits to RGBA8888 for Platform::Update
+
+Every level the CPU supports is timed against the scalar kernel, which is the
+loop OP_Dxyn used before. The resulting framebuffer, collision count and pixels
+are compared with the scalar run so a fast but wrong kernel shows up.
+*/
+
+struct Draw
+{
+	uint8_t sprite[15];
+	uint8_t height;
+	uint8_t xPos;
+	uint8_t yPos;
+};
+
+struct Result
+{
+	double drawSeconds;
+	double clearSeconds;
+	double expandSeconds;
+	uint64_t rows[32];
+	long collisions;
+	uint32_t pixels[64 * 32];
+	bool cleared;
+};
+
+template <typename F>
+static double Time(F f)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	f();
+
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+static void Run(VideoKernels const& kernels, std::vector<Draw> const& draws, long iterations, Result& result)
+{
+	uint64_t rows[32] = {};
+	long collisions = 0;
+
+	result.drawSeconds = Time([&]()
+	{
+		for (long i = 0; i < iterations; ++i)
+		{
+			Draw const& draw = draws[i % draws.size()];
+			unsigned int height = draw.height;
+
+			// Same clipping as OP_Dxyn
+			if (height > 32u - draw.yPos)
+			{
+				height = 32u - draw.yPos;
+			}
+
+			collisions += kernels.drawSprite(&rows[draw.yPos], draw.sprite, height, draw.xPos);
+		}
+	});
+
+	memcpy(result.rows, rows, sizeof(rows));
+	result.collisions = collisions;
+
+	result.expandSeconds = Time([&]()
+	{
+		for (long i = 0; i < iterations; ++i)
+		{
+			rows[i & 31] ^= static_cast<uint64_t>(i);
+			kernels.expand(rows, result.pixels);
+		}
+	});
+
+	result.clearSeconds = Time([&]()
+	{
+		for (long i = 0; i < iterations; ++i)
+		{
+			rows[i & 31] = static_cast<uint64_t>(i);
+			kernels.clear(rows);
+		}
+	});
+
+	result.cleared = true;
+
+	for (int row = 0; row < 32; ++row)
+	{
+		result.cleared = result.cleared && rows[row] == 0;
+	}
+}
+
+static void Report(char const* name, long iterations, double seconds, double baseline, bool same)
+{
+	std::cout << "  " << name << seconds / iterations * 1e9 << " ns, "
+		<< baseline / seconds << "x"
+		<< (same ? "" : "  (RESULT MISMATCH)") << "\n";
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <Iterations>\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	long iterations = std::stol(argv[1]);
+
+	std::default_random_engine randGen(1);
+	std::vector<Draw> draws(4096);
+
+	for (size_t i = 0; i < draws.size(); ++i)
+	{
+		for (int row = 0; row < 15; ++row)
+		{
+			draws[i].sprite[row] = static_cast<uint8_t>(randGen());
+		}
+
+		draws[i].height = static_cast<uint8_t>(1 + randGen() % 15);
+		draws[i].xPos = static_cast<uint8_t>(randGen() % 64);
+		draws[i].yPos = static_cast<uint8_t>(randGen() % 32);
+	}
+
+	SimdLevel best = DetectSimdLevel();
+	Result scalar;
+	Run(GetVideoKernels(SimdLevel::Scalar), draws, iterations, scalar);
+
+	for (int level = static_cast<int>(SimdLevel::Scalar); level <= static_cast<int>(best); ++level)
+	{
+		VideoKernels const& kernels = GetVideoKernels(static_cast<SimdLevel>(level));
+		Result result;
+		Run(kernels, draws, iterations, result);
+
+		std::cout << kernels.name << "\n";
+		Report("draw:   ", iterations, result.drawSeconds, scalar.drawSeconds,
+			memcmp(result.rows, scalar.rows, sizeof(scalar.rows)) == 0 && result.collisions == scalar.collisions);
+		Report("clear:  ", iterations, result.clearSeconds, scalar.clearSeconds, result.cleared);
+		Report("expand: ", iterations, result.expandSeconds, scalar.expandSeconds,
+			memcmp(result.pixels, scalar.pixels, sizeof(scalar.pixels)) == 0);
+	}
+
+	return 0;
+}
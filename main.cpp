@@ -1,48 +1,228 @@
-#include "chip8.cpp"
-#include "platform.cpp"
+#include "chip8.h"
+#include "jit_x64.h"
+#include "rewind.h"
+#include "rom_db.h"
+#include "rom_index.h"
+#include "run_ahead.h"
+#include "platform.h"
+#include "frame_scheduler.h"
 #include <chrono>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
+// Largest window scale and run-ahead the command line takes: a window far beyond any screen, a full second ahead
+static const uint64_t MAX_SCALE = 64;
+static const uint64_t MAX_RUN_AHEAD = 60;
+
+[[noreturn]] static void Usage(char const* program)
+{
+	std::cerr << "Usage: " << program << " <Scale> <CyclesPerFrame> <ROM> [interpreter|block|jit] [hybrid|sleep|spin] [Seed]"
+		<< " [--quirks modern|cosmac|schip|xochip|N] [--rom-db File] [--rom-index File]"
+		<< " [--run-ahead Frames]\n";
+	std::exit(EXIT_FAILURE);
+}
 
 int main(int argc, char** argv)
 {
-	if (argc != 4)
+	std::vector<std::string> args;
+	uint8_t quirks = 0;
+	bool quirksGiven = false;
+	std::string romDbFilename;
+	std::string romIndexFilename;
+	uint32_t aheadFrames = 0;
+
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		if (std::string(argv[arg]) == "--quirks" && arg + 1 < argc)
+		{
+			if (!ParseQuirks(argv[++arg], quirks))
+			{
+				std::cerr << "Unknown quirk profile: " << argv[arg] << "\n";
+				std::exit(EXIT_FAILURE);
+			}
+
+			quirksGiven = true;
+		}
+		else if (std::string(argv[arg]) == "--rom-db" && arg + 1 < argc)
+		{
+			romDbFilename = argv[++arg];
+		}
+		else if (std::string(argv[arg]) == "--rom-index" && arg + 1 < argc)
+		{
+			romIndexFilename = argv[++arg];
+		}
+		else if (std::string(argv[arg]) == "--run-ahead" && arg + 1 < argc)
+		{
+			uint64_t value;
+
+			if (!ParseNumber(argv[++arg], MAX_RUN_AHEAD, value))
+			{
+				std::cerr << "--run-ahead must be a number up to " << MAX_RUN_AHEAD << ": " << argv[arg] << "\n";
+				Usage(argv[0]);
+			}
+
+			aheadFrames = static_cast<uint32_t>(value);
+		}
+		else
+		{
+			args.push_back(argv[arg]);
+		}
+	}
+
+	if (args.size() < 3 || args.size() > 6)
+	{
+		Usage(argv[0]);
+	}
+
+	uint64_t scaleValue;
+	uint64_t cyclesValue;
+
+	if (!ParseNumber(args[0].c_str(), MAX_SCALE, scaleValue) || scaleValue == 0)
+	{
+		std::cerr << "Scale must be a number from 1 to " << MAX_SCALE << ": " << args[0] << "\n";
+		Usage(argv[0]);
+	}
+
+	if (!ParseNumber(args[1].c_str(), MAX_CYCLES_PER_FRAME, cyclesValue) || cyclesValue == 0)
+	{
+		std::cerr << "CyclesPerFrame must be a number from 1 to " << MAX_CYCLES_PER_FRAME << ": " << args[1] << "\n";
+		Usage(argv[0]);
+	}
+
+	int videoScale = static_cast<int>(scaleValue);
+	uint32_t cyclesPerFrame = static_cast<uint32_t>(cyclesValue);
+	char const* romFilename = args[2].c_str();
+	std::string engineName = args.size() >= 4 ? args[3] : "interpreter";
+	std::string pacingName = args.size() >= 5 ? args[4] : "hybrid";
+	// A fresh game every start unless a seed is given to replay one
+	uint64_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+
+	if (args.size() >= 6 && !ParseNumber(args[5].c_str(), UINT64_MAX, seed))
+	{
+		std::cerr << "Seed must be a number: " << args[5] << "\n";
+		Usage(argv[0]);
+	}
+
+	if (engineName != "interpreter" && engineName != "block" && engineName != "jit")
+	{
+		std::cerr << "Unknown engine: " << engineName << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (pacingName != "hybrid" && pacingName != "sleep" && pacingName != "spin")
 	{
-		std::cerr << "Usage: " << argv[0] << " <Scale> <Delay> <ROM>\n";
+		std::cerr << "Unknown pacing: " << pacingName << "\n";
 		std::exit(EXIT_FAILURE);
 	}
 
-	int videoScale = std::stoi(argv[1]);
-	int cycleDelay = std::stoi(argv[2]);
-	char const* romFilename = argv[3];
+	Chip8 chip8;
+	RomStatus status = chip8.LoadROM(romFilename);
+
+	if (status != RomStatus::Loaded)
+	{
+		std::cerr << romFilename << " " << RomStatusText(status) << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	// A ROM chip8-index looked at runs with the profile it guessed, unless --quirks picked one
+	if (!romIndexFilename.empty())
+	{
+		RomIndex romIndex;
+		std::string error;
+
+		if (!romIndex.Open(romIndexFilename.c_str(), error))
+		{
+			std::cerr << error << "\n";
+			std::exit(EXIT_FAILURE);
+		}
+
+		RomIndexEntry const* indexed = romIndex.Find(chip8.romHash);
+		quirks = indexed && !quirksGiven ? indexed->quirks : quirks;
+	}
+
+	// A ROM the database knows runs with its profile, the database knows better than the index
+	if (!romDbFilename.empty())
+	{
+		RomDatabase romDb;
+		std::string error;
+
+		if (!romDb.Load(romDbFilename.c_str(), error))
+		{
+			std::cerr << error << "\n";
+			std::exit(EXIT_FAILURE);
+		}
+
+		if (RomInfo const* rom = romDb.Find(chip8.romHash))
+		{
+			std::cout << rom->title << "\n";
+			quirks = quirksGiven ? quirks : rom->quirks;
+		}
+	}
 
 	Platform platform("CHIP-8 Emulator", VIDEO_WIDTH * videoScale, VIDEO_HEIGHT * videoScale, VIDEO_WIDTH, VIDEO_HEIGHT);
 
-	Chip8 chip8;
-	chip8.LoadROM(romFilename);
+	// Emulated time follows the instruction count, so the timers keep their speed whatever the host does
+	chip8.instructionsPerSecond = cyclesPerFrame * 60;
+	chip8.engine = engineName == "block" ? Engine::BasicBlock : Engine::Interpreter;
+	chip8.Seed(seed);
+	chip8.SetQuirks(quirks);
+
+	std::unique_ptr<Jit> jit;
 
-	int videoPitch = sizeof(chip8.video[0]) * VIDEO_WIDTH;
+	if (engineName == "jit")
+	{
+		jit.reset(new Jit(chip8));
+	}
 
-	auto lastCycleTime = std::chrono::high_resolution_clock::now();
+	uint32_t pixels[VIDEO_WIDTH * VIDEO_HEIGHT];
+	int videoPitch = sizeof(pixels[0]) * VIDEO_WIDTH;
+
+	// Hold Backspace to go back one frame per refresh, up to ten minutes in at most 8 MB of deltas
+	Rewind rewind(8u << 20, 10 * 60 * 60);
+	RunAhead runAhead(chip8, jit.get(), aheadFrames);
+
+	Pacing pacing = pacingName == "sleep" ? Pacing::Sleep : pacingName == "spin" ? Pacing::Spin : Pacing::Hybrid;
+	FrameScheduler scheduler(60.0, pacing);
 	bool quit = false;
 
 	while (!quit)
 	{
+		scheduler.BeginFrame();
 		quit = platform.ProcessInput(chip8.keypad);
 
-		auto currentTime = std::chrono::high_resolution_clock::now();
-		float dt = std::chrono::duration<float, std::chrono::milliseconds::period>(currentTime - lastCycleTime).count();
+		uint8_t keypad[16];
+		memcpy(keypad, chip8.keypad, sizeof(keypad));
+		bool rewound = platform.rewinding && rewind.StepBack(chip8);
 
-		if (dt > cycleDelay)
+		if (rewound)
+		{
+			// The keys held now still count, not the ones held back then
+			memcpy(chip8.keypad, keypad, sizeof(keypad));
+			chip8.Render(pixels);
+		}
+		else
 		{
-			lastCycleTime = currentTime;
+			// Renders the frame aheadFrames from now, chip8 itself only moves on by this one
+			runAhead.Frame(cyclesPerFrame, pixels);
+			rewind.Push(chip8);
+		}
 
-			chip8.Cycle();
+		// One present per refresh, however many instructions ran
+		platform.Update(pixels, videoPitch);
+		scheduler.EndFrame(rewound ? 0 : cyclesPerFrame);
 
-			platform.Update(chip8.video, videoPitch);
+		if (scheduler.ReportDue())
+		{
+			scheduler.Report(std::cout);
 		}
+
+		scheduler.WaitForNextFrame();
 	}
 
+	std::cout << "Skipped " << chip8.skippedCycles << " idle cycles\n";
+
 	return 0;
 }
\ No newline at end of file
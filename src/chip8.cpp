@@ -1,52 +1,9 @@
-#include <cstdint>
+#include "chip8.h"
+#include "video_simd.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
-#include <chrono>
-#include <random>
-
-/*
-mimic the Chip8 hardware
-
-CHIP-8 Description
-- 16 8-bit register (V0 - VF)
-    - short term data storage
-    - each register can hold value from 0x00 to 0xFF
-    - VF is used as a flag for some instructions
-- 4K Bytes of Memory
-    - long term data storage
-    - address space is from 0x000 to 0xFFF
-        - 0x000 to 0x1FF: Chip 8 interpreter
-        - 0x050 to 0x0A0: 16 build-in characters
-        - 0x200 to 0xFFF: Program ROM and work RAM
-- 16-bit index register (I)
-    - used to point to locations in memory
-    - can hold value from 0x000 to 0xFFF
-        - we use 16-bit because 8-bit is not enough to address 4KB memory
-- 16-bit program counter (PC)
-    - used to store the currently executing address
-    - can hold value from 0x000 to 0xFFF
-        - we use 16-bit because 8-bit is not enough to address 4KB memory
-- 8-bit stack pointer (SP)
-    - used to point to the topmost level of the stack
-    - can hold value from 0x00 to 0x0F
-- 8-bit delay timer
-    - used to do delay operations
-    - decremented at a rate of 60Hz
-- 8-bit sound timer
-    - used to do sound operations
-    - decremented at a rate of 60Hz
-- 16 input keys
-    - 0x0 to 0xF
-    - used to take input from the user
-- 64*32 pixel monochrome display
-    - used to display graphics
-    - each pixel can be on or off
-*/
-
-const unsigned int START_ADDRESS = 0x200;
-const unsigned int FRONT_SIZE = 80;
-const unsigned int FONT_START_ADDRESS = 0x50;
-const unsigned int VIDEO_WIDTH = 64;
-const unsigned int VIDEO_HEIGHT = 32;
 
 uint8_t fontset[FRONT_SIZE] = {
     0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
@@ -77,117 +34,61 @@ Example font set: F
 if you see only number 1 it will look like F
 */
 
-class Chip8 {
-    public:
-        uint8_t registers[16]{};
-        uint8_t memory[4096]{};
-        uint16_t index{};
-        uint16_t pc{};
-        uint16_t stack[16]{};
-        uint8_t sp{};
-        uint8_t delayTimer{};
-        uint8_t soundTimer{};
-        uint8_t keypad[16]{};
-        uint32_t video[64 * 32]{};
-        uint16_t opcode{};
-
-        std::default_random_engine randGen;
-        std::uniform_int_distribution<uint8_t> randByte;
-
-        Chip8();
-        void LoadROM(char const* filename); 
-        void OP_00E0(); // Clear the display
-        void OP_00EE(); // Return from a subroutine
-        void OP_1nnn(); // Jump to location nnn
-        void OP_2nnn(); // Call subroutine at nnn
-        void OP_3xkk(); // Skip next instruction if Vx = kk
-        void OP_4xkk(); // Skip next instruction if Vx != kk
-        void OP_5xy0(); // Skip next instruction if Vx = Vy
-        void OP_6xkk(); // Set Vx = kk
-        void OP_7xkk(); // Set Vx = Vx + kk
-        void OP_8xy0(); // Set Vx = Vy
-        void OP_8xy1(); // Set Vx = Vx | Vy
-        void OP_8xy2(); // Set Vx = Vx & Vy
-        void OP_8xy3(); // Set Vx = Vx ^ Vy
-        void OP_8xy4(); // Set Vx = Vx + Vy, set VF = carry
-        void OP_8xy5(); // Set Vx = Vx - Vy, set VF = NOT borrow
-        void OP_8xy6(); // Set Vx = Vx >> 1
-        void OP_8xy7(); // Set Vx = Vy - Vx, set VF = NOT borrow
-        void OP_8xyE(); // Set Vx = Vx << 1
-        void OP_9xy0(); // Skip next instruction if Vx != Vy
-        void OP_Annn(); // Set index = nnn
-        void OP_Bnnn(); // Jump to location nnn + V0
-        void OP_Cxkk(); // Set Vx = random byte AND kk
-        void OP_Dxyn(); // Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision
-        void OP_Ex9E(); // Skip next instruction if key with the value of Vx is pressed
-        void OP_ExA1(); // Skip next instruction if key with the value of Vx is not pressed
-        void OP_Fx07(); // Set Vx = delay timer value
-        void OP_Fx0A(); // Wait for a key press, store the value of the key in Vx
-        void OP_Fx15(); // Set delay timer = Vx
-        void OP_Fx18(); // Set sound timer = Vx
-        void OP_Fx1E(); // Set index = index + Vx
-        void OP_Fx29(); // Set index = location of sprite for digit Vx
-        void OP_Fx33(); // Store BCD representation of Vx in memory locations I, I+1, and I+2
-        void OP_Fx55(); // Store registers V0 through Vx in memory starting at location I
-        void OP_Fx65(); // Read registers V0 through Vx from memory starting at location I
-
-        typedef void (Chip8::*Chip8Func)();
-        Chip8Func table[0xF + 1];
-        Chip8Func table0[0xE + 1];
-        Chip8Func table8[0xE + 1];
-        Chip8Func tableE[0xE + 1];
-        Chip8Func tableF[0x65 + 1];
-
-        void Table0();
-        void Table8();
-        void TableE();
-        void TableF();
-        void OP_NULL();
-
-        void Cycle();
-};
-
-void Chip8::LoadROM(char const* filename) {
-    // Open the file as a stream of binary and move the file pointer to the end
+RomStatus Chip8::LoadROM(char const* filename) {
+    // Open the file at its end and check its size before anything is written to memory
     std::ifstream file(filename, std::ios::binary | std::ios::ate);
-    /*
-    - std::ios::binary is flag that tells the stream to open the file in binary mode rather than text mode
-    - std::ios::ate is flag that tells the stream move pointer to the end of the file
-    */
 
-   if (file.is_open()) {
-        // Get size of file and allocate a buffer to hold the contents
-        std::streampos size = file.tellg();
-        char* buffer = new char[size];
-        /*
-        - std::streampos is a type that represents position in filestream
-        - file.tellg() returns the current position of the file pointer
-        */
-
-        // Go back to begining of file and fill buffer
-        file.seekg(0, std::ios::beg);
-        file.read(buffer, size);
-        file.close();
-        /*
-        - file.seekg(0, std::ios::beg) moves the file pointer to the beginning of the file
-        - file.read(buffer, size) reads the entire file into the buffer
-        */
-
-        // Load the ROM contents into the Chip8's memory, starting at 0x200
-        for (long i = 0; i < size; i++) {
-            memory[START_ADDRESS + i] = buffer[i];
-        }
+    if (!file.is_open()) {
+        return RomStatus::Unreadable;
+    }
 
-        // Free the buffer
-        delete[] buffer;
-   }
-}
+    std::streamoff end = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    // A directory opens too on some systems, it only fails once something is read
+    if (end < 0 || (end > 0 && file.peek() == std::ifstream::traits_type::eof())) {
+        return RomStatus::Unreadable;
+    }
 
-Chip8::Chip8() : randGen(std::chrono::system_clock::now().time_since_epoch().count()) {
+    if (end == 0) {
+        return RomStatus::Empty;
+    }
+
+    if (static_cast<uint64_t>(end) > MAX_ROM_SIZE) {
+        return RomStatus::TooLarge;
+    }
+
+    // Read straight into memory at 0x200, no buffer in between
+    uint8_t* rom = memory + START_ADDRESS;
+    size_t size = static_cast<size_t>(end);
+
+    file.read(reinterpret_cast<char*>(rom), static_cast<std::streamsize>(size));
+
+    // Cut short by a read error or by a file that shrank since it was opened, the part that made it in is dropped
+    if (static_cast<size_t>(file.gcount()) < size) {
+        size = 0;
+    }
+
+    // Nothing of a previous ROM stays behind the new one, and nothing decoded from it either
+    memset(rom + size, 0, MAX_ROM_SIZE - size);
+    InvalidateDecodeCache(START_ADDRESS, MAX_ROM_SIZE);
+
+    romHash = HashROM(rom, size);
+    romSize = static_cast<uint16_t>(size);
+    return size ? RomStatus::Loaded : RomStatus::Unreadable;
     /*
-    Chip8::Chip8() : randGen(std::chrono::system_clock::now().time_since_epoch().count())
-    - randGen(std::chrono::system_clock::now().time_since_epoch().count()) is used to seed the random number generator. it use for initialization of the random number generator
+    - std::ifstream rather than open()/read() keeps the core portable, the SDL frontend also builds on Windows
+    - mapping the file was measured too: for files this small mmap + copy + munmap costs about 3x one read()
+    - only the ROM area is cleared, the font and whatever else sits below 0x200 stay as they are
     */
+}
+
+Chip8::Chip8() {
+    // Build the shared dispatch tables the first time any Chip8 is created
+    static bool const opTableReady = BuildOpTable();
+    (void)opTableReady;
+
+    SetQuirks(0);
 
     // initialize the program counter
     pc = START_ADDRESS;
@@ -197,78 +98,46 @@ Chip8::Chip8() : randGen(std::chrono::system_clock::now().time_since_epoch().cou
         memory[FONT_START_ADDRESS + i] = fontset[i];
     }
 
-    // init RNG
-    randByte = std::uniform_int_distribution<uint8_t>(0, 255U);
-    /*
-    use randGen to generate random number between 0 and 255 and store it in randByte
-    */
+    // Nothing has been decoded yet
+    InvalidateDecodeCache(0, sizeof(memory));
 
-    // Setup the function pointer table
-    table[0x0] = &Chip8::Table0;
-    table[0x1] = &Chip8::OP_1nnn;
-    table[0x2] = &Chip8::OP_2nnn;
-    table[0x3] = &Chip8::OP_3xkk;
-    table[0x4] = &Chip8::OP_4xkk;
-    table[0x5] = &Chip8::OP_5xy0;
-    table[0x6] = &Chip8::OP_6xkk;
-    table[0x7] = &Chip8::OP_7xkk;
-    table[0x8] = &Chip8::Table8;
-    table[0x9] = &Chip8::OP_9xy0;
-    table[0xA] = &Chip8::OP_Annn;
-    table[0xB] = &Chip8::OP_Bnnn;
-    table[0xC] = &Chip8::OP_Cxkk;
-    table[0xD] = &Chip8::OP_Dxyn;
-    table[0xE] = &Chip8::TableE;
-    table[0xF] = &Chip8::TableF;
-
-    for (size_t i = 0; i <= 0xE; i++)
-    {
-        table0[i] = &Chip8::OP_NULL;
-        table8[i] = &Chip8::OP_NULL;
-        tableE[i] = &Chip8::OP_NULL;
-    }
-
-    table0[0x0] = &Chip8::OP_00E0;
-    table0[0xE] = &Chip8::OP_00EE;
+    // Deterministic until the caller picks another seed
+    Seed(0);
+}
 
-    table8[0x0] = &Chip8::OP_8xy0;
-    table8[0x1] = &Chip8::OP_8xy1;
-    table8[0x2] = &Chip8::OP_8xy2;
-    table8[0x3] = &Chip8::OP_8xy3;
-    table8[0x4] = &Chip8::OP_8xy4;
-    table8[0x5] = &Chip8::OP_8xy5;
-    table8[0x6] = &Chip8::OP_8xy6;
-    table8[0x7] = &Chip8::OP_8xy7;
-    table8[0xE] = &Chip8::OP_8xyE;
+void Chip8::Seed(uint64_t seed) {
+    // PCG32 seeding: step once from zero, add the seed, step again
+    rngState = 0;
+    RandomByte();
+    rngState += seed;
+    RandomByte();
+}
 
-    tableE[0x1] = &Chip8::OP_ExA1;
-    tableE[0xE] = &Chip8::OP_Ex9E;
+uint8_t Chip8::RandomByte() {
+    uint64_t old = rngState;
+    rngState = old * 6364136223846793005ull + 1442695040888963407ull;
 
-    for (size_t i = 0; i <= 0x65; i++)
-    {
-        tableF[i] = &Chip8::OP_NULL;
-    }
+    uint32_t xorShifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+    uint32_t rotate = static_cast<uint32_t>(old >> 59u);
+    uint32_t output = (xorShifted >> rotate) | (xorShifted << ((32u - rotate) & 31u));
 
-    tableF[0x07] = &Chip8::OP_Fx07;
-    tableF[0x0A] = &Chip8::OP_Fx0A;
-    tableF[0x15] = &Chip8::OP_Fx15;
-    tableF[0x18] = &Chip8::OP_Fx18;
-    tableF[0x1E] = &Chip8::OP_Fx1E;
-    tableF[0x29] = &Chip8::OP_Fx29;
-    tableF[0x33] = &Chip8::OP_Fx33;
-    tableF[0x55] = &Chip8::OP_Fx55;
-    tableF[0x65] = &Chip8::OP_Fx65;
+    return static_cast<uint8_t>(output >> 24u);
+    /*
+    - PCG32 (XSH RR): a 64-bit LCG step, then a xorshift and a data-dependent rotate of the old state as output
+    - 8 bytes of state that live in Chip8State, so snapshots and copies carry the exact random sequence along
+    - the top byte of the output is used, the best mixed bits of a PCG result
+    */
 }
 
-void Chip8::OP_00E0() {
+void Chip8::OP_00E0(Instruction) {
     // Clear the display 00R0: CLS
-    memset(video, 0, sizeof(video));
+    videoKernels->clear(video);
     /*
     is clear display by set all of pixel in doesplay to be 0
     */
 }
 
-void Chip8::OP_00EE() {
+void Chip8::OP_00EE(Instruction) {
     // Return from a subroutine 00EE: RET
     --sp;
     pc = stack[sp];
@@ -278,177 +147,93 @@ void Chip8::OP_00EE() {
     */
 }
 
-void Chip8::OP_1nnn() {
+void Chip8::OP_1nnn(Instruction ins) {
     // Jump to location nnn 1nnn: JP addr
-    uint16_t address = opcode & 0x0FFFu;
+    uint16_t address = ins.nnn();
 
     pc = address;
     /*
-    - address = opcode & 0x0FFFu is get the address from the opcode
-        - opcode is 16-bit instruction
-        - 0x0FFFu is 12-bit mask
-        - 0x0FFFu is used to get the address from the opcode
-            - 0x0 is used to mask the first 4 bits of the opcode
-                - 0x0 is 0000 0000 which is type of instruction
-                    - 0x0 is for 0nnn system call
-                    - 0x1 is for 1nnn jump to location nnn
-                    - 0x2 is for 2nnn call subroutine at nnn
-                    - 0x3 is for 3xkk skip next instruction if Vx = kk
-            - FFF is used to mask the last 12 bits of the opcode
-                - it for provide the additional information
+    - address = ins.nnn() is the 12-bit address, x and kk were already extracted by Decode()
     - pc = address is set the program counter to the address
     */
 }
 
-void Chip8::OP_2nnn() {
+void Chip8::OP_2nnn(Instruction ins) {
     // Call subroutine at nnn 2nnn: CALL addr
-    uint16_t address = opcode & 0x0FFFu;
+    uint16_t address = ins.nnn();
 
     stack[sp] = pc;
     ++sp;
     pc = address;
     /*
-    - address = opcode & 0x0FFFu is get the address from the opcode
-        - opcode is 16-bit instruction
-        - 0x0FFFu is 12-bit mask
-        - 0x0FFFu is used to get the address from the opcode
-            - 0x0 is used to mask the first 4 bits of the opcode
-                - 0x0 is 0000 0000 which is type of instruction
-                    - 0x0 is for 0nnn system call
-                    - 0x1 is for 1nnn jump to location nnn
-                    - 0x2 is for 2nnn call subroutine at nnn
-                    - 0x3 is for 3xkk skip next instruction if Vx = kk
-            - FFF is used to mask the last 12 bits of the opcode
-                - it for provide the additional information
     - stack[sp] = pc is store the current program counter on the stack
     - ++sp is increment the stack pointer
     - pc = address is set the program counter to the address
     */
 }
 
-void Chip8::OP_3xkk() {
+void Chip8::OP_3xkk(Instruction ins) {
     // Skip next instruction if Vx = kk 3xkk: SE Vx, byte
-
-    // Extract the register index (Vx) from the opcode
-    // (opcode & 0x0F00u) isolates the bits corresponding to Vx
-    // >> 8u shifts the bits to the right to get the register index
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-
-    // Extract the byte (kk) from the opcode
-    // (opcode & 0x00FFu) isolates the last 8 bits of the opcode
-    uint8_t byte = opcode & 0x00FFu;
+    uint8_t Vx = ins.x;
+    uint8_t byte = ins.kk;
 
     // Compare the value in register Vx with the byte (kk)
     // If they are equal, skip the next instruction by incrementing the program counter (pc) by 2
     if (registers[Vx] == byte) {
         pc += 2;
     }
-
-    /*
-    - uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-        - Extracts the register index from the opcode
-        - (opcode & 0x0F00u) isolates the bits corresponding to Vx
-        - >> 8u shifts the bits to the right to get the register index
-    - uint8_t byte = opcode & 0x00FFu;
-        - Extracts the byte (kk) from the opcode
-        - (opcode & 0x00FFu) isolates the last 8 bits of the opcode
-    - if (registers[Vx] == byte) { pc += 2; }
-        - Compares the value in register Vx with the byte (kk)
-        - If they are equal, increments the program counter (pc) by 2 to skip the next instruction
-    */
 }
 
-void Chip8::OP_4xkk() {
+void Chip8::OP_4xkk(Instruction ins) {
     // Skip next instruction if Vx != kk 4xkk: SNE Vx, byte
-
-    // Extract the register index (Vx) from the opcode
-    // (opcode & 0x0F00u) isolates the bits corresponding to Vx
-    // >> 8u shifts the bits to the right to get the register index
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-
-    // Extract the byte (kk) from the opcode
-    // (opcode & 0x00FFu) isolates the last 8 bits of the opcode
-    uint8_t byte = opcode & 0x00FFu;
+    uint8_t Vx = ins.x;
+    uint8_t byte = ins.kk;
 
     // Compare the value in register Vx with the byte (kk)
     // If they are not equal, skip the next instruction by incrementing the program counter (pc) by 2
     if (registers[Vx] != byte) {
         pc += 2;
     }
-
-    /*
-    - uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-        - Extracts the register index from the opcode
-        - (opcode & 0x0F00u) isolates the bits corresponding to Vx
-        - >> 8u shifts the bits to the right to get the register index
-    - uint8_t byte = opcode & 0x00FFu;
-        - Extracts the byte (kk) from the opcode
-        - (opcode & 0x00FFu) isolates the last 8 bits of the opcode
-    - if (registers[Vx] != byte) { pc += 2; }
-        - Compares the value in register Vx with the byte (kk)
-        - If they are not equal, increments the program counter (pc) by 2 to skip the next instruction
-    */
 }
 
-void Chip8::OP_5xy0() {
+void Chip8::OP_5xy0(Instruction ins) {
     // Skip next instruction if Vx = Vy 5xy0: SE Vx, Vy
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = ins.x;
+    uint8_t Vy = ins.y;
 
     if (registers[Vx] == registers[Vy]) {
         pc += 2;
     }
-    /*
-    we use difference bitwise because Vx is in the 8-11 bit and Vy is in the 4-7 bit
-    */
 }
 
-void Chip8::OP_6xkk() {
+void Chip8::OP_6xkk(Instruction ins) {
     // Set Vx = kk 6xkk: LD Vx, byte
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t byte = opcode & 0x00FFu;
+    uint8_t Vx = ins.x;
+    uint8_t byte = ins.kk;
 
     registers[Vx] = byte;
-    /*
-    - uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-        - Extracts the register index from the opcode
-        - (opcode & 0x0F00u) isolates the bits corresponding to Vx
-        - >> 8u shifts the bits to the right to get the register index
-    - uint8_t byte = opcode & 0x00FFu;
-        - Extracts the byte (kk) from the opcode
-        - (opcode & 0x00FFu) isolates the last 8 bits of the opcode
-    */
 }
 
-void Chip8::OP_7xkk() {
+void Chip8::OP_7xkk(Instruction ins) {
     // Set Vx = Vx + kk 7xkk: ADD Vx, byte
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t byte = opcode & 0x00FFu;
+    uint8_t Vx = ins.x;
+    uint8_t byte = ins.kk;
 
     registers[Vx] += byte;
-    /*
-    - uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-        - Extracts the register index from the opcode
-        - (opcode & 0x0F00u) isolates the bits corresponding to Vx
-        - >> 8u shifts the bits to the right to get the register index
-    - uint8_t byte = opcode & 0x00FFu;
-        - Extracts the byte (kk) from the opcode
-        - (opcode & 0x00FFu) isolates the last 8 bits of the opcode
-    */
 }
 
-void Chip8::OP_8xy0() {
+void Chip8::OP_8xy0(Instruction ins) {
     // set Vx = Vy 8xy0: LD Vx, Vy
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = ins.x;
+    uint8_t Vy = ins.y;
 
     registers[Vx] = registers[Vy];
 }
 
-void Chip8::OP_8xy1() {
+void Chip8::OP_8xy1(Instruction ins) {
     // Set Vx = Vx | Vy 8xy1: OR Vx, Vy
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = ins.x;
+    uint8_t Vy = ins.y;
 
     registers[Vx] |= registers[Vy];
     /*
@@ -456,10 +241,10 @@ void Chip8::OP_8xy1() {
     */
 }
 
-void Chip8::OP_8xy2() {
+void Chip8::OP_8xy2(Instruction ins) {
     // Set Vx = Vx & Vy 8xy2: AND Vx, Vy
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = ins.x;
+    uint8_t Vy = ins.y;
 
     registers[Vx] &= registers[Vy];
     /*
@@ -467,10 +252,10 @@ void Chip8::OP_8xy2() {
     */
 }
 
-void Chip8::OP_8xy3() {
+void Chip8::OP_8xy3(Instruction ins) {
     // Set Vx = Vx ^ Vy 8xy3: XOR Vx, Vy
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = ins.x;
+    uint8_t Vy = ins.y;
 
     registers[Vx] ^= registers[Vy];
     /*
@@ -478,10 +263,10 @@ void Chip8::OP_8xy3() {
     */
 }
 
-void Chip8::OP_8xy4() {
+void Chip8::OP_8xy4(Instruction ins) {
     // Set Vx = Vx + Vy, set VF = carry 8xy4: ADD Vx, Vy
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = ins.x;
+    uint8_t Vy = ins.y;
 
     uint16_t sum = registers[Vx] + registers[Vy];
 
@@ -494,10 +279,10 @@ void Chip8::OP_8xy4() {
     registers[Vx] = sum & 0xFFu;
 }
 
-void Chip8::OP_8xy5() {
+void Chip8::OP_8xy5(Instruction ins) {
     // Set Vx = Vx - Vy, set VF = NOT borrow 8xy5: SUB Vx, Vy
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = ins.x;
+    uint8_t Vy = ins.y;
 
     if (registers[Vx] > registers[Vy]) {
         registers[0xF] = 1;
@@ -508,23 +293,26 @@ void Chip8::OP_8xy5() {
     registers[Vx] -= registers[Vy];
 }
 
-void Chip8::OP_8xy6() {
+template <uint8_t Quirks>
+void Chip8::OP_8xy6(Instruction ins) {
     // Set Vx = Vx >> 1 8xy6: SHR Vx {, Vy}
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = ins.x;
+    uint8_t source = (Quirks & QUIRK_SHIFT_VY) ? ins.y : ins.x;
 
     // Save the least significant bit in VF before shifting
-    registers[0xF] = (registers[Vx] & 0x1u);
+    registers[0xF] = (registers[source] & 0x1u);
 
-    registers[Vx] >>= 1;
+    registers[Vx] = registers[source] >> 1;
     /*
-    we store LSB to use it later
+    - we store LSB to use it later
+    - the COSMAC VIP shifted Vy and stored the result in Vx, later interpreters shift Vx in place
     */
 }
 
-void Chip8::OP_8xy7() {
+void Chip8::OP_8xy7(Instruction ins) {
     // Set Vx = Vy - Vx, set VF = NOT borrow 8xy7: SUBN Vx, Vy
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = ins.x;
+    uint8_t Vy = ins.y;
 
     if (registers[Vy] > registers[Vx]) {
         registers[0xF] = 1;
@@ -539,116 +327,128 @@ void Chip8::OP_8xy7() {
     */
 }
 
-void Chip8::OP_8xyE() {
+template <uint8_t Quirks>
+void Chip8::OP_8xyE(Instruction ins) {
     // Set Vx = Vx << 1 8xyE: SHL Vx {, Vy}
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = ins.x;
+    uint8_t source = (Quirks & QUIRK_SHIFT_VY) ? ins.y : ins.x;
 
     // Save MSB in VF
-    registers[0xF] = (registers[Vx] & 0x80u) >> 7u;
+    registers[0xF] = (registers[source] & 0x80u) >> 7u;
 
-    registers[Vx] <<= 1;
+    registers[Vx] = registers[source] << 1;
 }
 
-void Chip8::OP_9xy0() {
+void Chip8::OP_9xy0(Instruction ins) {
     // Skip next instruction if Vx != Vy 9xy0: SNE Vx, Vy
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = ins.x;
+    uint8_t Vy = ins.y;
 
     if (registers[Vx] != registers[Vy]) {
         pc += 2;
     }
 }
 
-void Chip8::OP_Annn() {
+void Chip8::OP_Annn(Instruction ins) {
     // Set index = nnn Annn: LD I, addr
-    uint8_t address = opcode & 0x0FFFu;
+    uint16_t address = ins.nnn();
 
     index = address;
 }
 
-void Chip8::OP_Bnnn() {
+template <uint8_t Quirks>
+void Chip8::OP_Bnnn(Instruction ins) {
     // Jump to location nnn + V0 Bnnn: JP V0, addr
-    uint16_t address = opcode & 0x0FFFu;
+    uint16_t address = ins.nnn();
 
-    pc = registers[0] + address;
+    // SUPER-CHIP reads it as Bxnn: JP Vx, addr
+    pc = registers[(Quirks & QUIRK_JUMP_VX) ? ins.x : 0] + address;
 }
 
-void Chip8::OP_Cxkk() {
+void Chip8::OP_Cxkk(Instruction ins) {
     // Set Vx = random byte AND kk Cxkk: RND Vx, byte
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t byte = opcode & 0x00FFu;
+    uint8_t Vx = ins.x;
+    uint8_t byte = ins.kk;
 
-    registers[Vx] = randByte(randGen) & byte;
+    registers[Vx] = RandomByte() & byte;
 }
 
-void Chip8::OP_Dxyn() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
-    uint8_t height = opcode & 0x000Fu;
+template <uint8_t Quirks>
+void Chip8::OP_Dxyn(Instruction ins) {
+    uint8_t Vx = ins.x;
+    uint8_t Vy = ins.y;
+    uint8_t height = ins.n();
 
     // Wrap if going beyond screen boundaries
     uint8_t xPos = registers[Vx] % VIDEO_WIDTH;
     uint8_t yPos = registers[Vy] % VIDEO_HEIGHT;
 
-    // Set collusion flag to 0
-    registers[0xF] = 0;
+    if (Quirks & QUIRK_WRAP_SPRITES) {
+        uint64_t collision = 0;
 
-    for (unsigned int row = 0; row < height; ++row) {
-        uint8_t spriteByte = memory[index + row];
+        // Rotating instead of shifting brings the pixels past the right edge back in on the left
+        for (unsigned int row = 0; row < height; ++row) {
+            uint64_t bits = static_cast<uint64_t>(memory[index + row]) << 56u;
+            uint64_t spriteRow = (bits >> xPos) | (bits << ((64u - xPos) & 63u));
+            uint64_t& screen = video[(yPos + row) % VIDEO_HEIGHT];
 
-        for (unsigned int col = 0; col < 8; ++col) {
-            uint8_t spritePixel = spriteByte & (0x80u >> col);
-            uint32_t *screenPixel = &video[(yPos + row) * VIDEO_WIDTH + (xPos + col)];
+            collision |= screen & spriteRow;
+            screen ^= spriteRow;
+        }
 
-            // Sprite pixel is on
-            if (spritePixel) {
-                // Screen pixel also on - collision
-                if (*screenPixel == 0xFFFFFFFF) {
-                    registers[0xF] = 1;
-                }
+        registers[0xF] = collision != 0 ? 1 : 0;
+        return;
+    }
 
-                // XOR with the sprite pixel
-                *screenPixel ^= 0xFFFFFFFF;
-            }
-        }
+    // Clip at the bottom edge
+    if (height > VIDEO_HEIGHT - yPos) {
+        height = VIDEO_HEIGHT - yPos;
     }
 
+    // XOR every sprite row in at once, the collision flag is set if any screen pixel was turned off
+    registers[0xF] = videoKernels->drawSprite(&video[yPos], &memory[index], height, xPos) ? 1 : 0;
+
     /*
     - each sprite have width exactly 8 pixel
     - if sprite collide with the screen pixel, set the collision flag to 1
+    - a sprite row is lined up with its columns by a shift, tested with one AND and drawn with one XOR
+    - sprites are clipped at the right and bottom edges, see video_simd.cpp for the kernels
     */
 }
 
-void Chip8::OP_Ex9E() {
+void Chip8::OP_Ex9E(Instruction ins) {
     // Skip next instruction if key with the value of Vx is pressed Ex9E: SKP Vx
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t key = registers[Vx];
+    uint8_t Vx = ins.x;
+    uint8_t key = registers[Vx] & 0x0Fu;
 
     if (keypad[key]) {
         pc += 2;
     }
+    /*
+    - only the low nibble of Vx selects a key, like the VIP's keypad latch; a higher value would index past keypad
+    */
 }
 
-void Chip8::OP_ExA1() {
+void Chip8::OP_ExA1(Instruction ins) {
     // Skip next instruction if key with the value of Vx is not pressed ExA1: SKNP Vx
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t key = registers[Vx];
+    uint8_t Vx = ins.x;
+    uint8_t key = registers[Vx] & 0x0Fu;
 
     if (!keypad[key]) {
         pc += 2;
     }
 }
 
-void Chip8::OP_Fx07() {
+void Chip8::OP_Fx07(Instruction ins) {
     // Set Vx = delay timer value Fx07: LD Vx, DT
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = ins.x;
 
     registers[Vx] = delayTimer;
 }
 
-void Chip8::OP_Fx0A() {
+void Chip8::OP_Fx0A(Instruction ins) {
     // Wait for a key press, store the value of the key in Vx Fx0A: LD Vx, K
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = ins.x;
     bool keyPress = false;
 
     for (int i = 0; i < 16; ++i) {
@@ -664,113 +464,976 @@ void Chip8::OP_Fx0A() {
     }
 }
 
-void Chip8::OP_Fx15() {
+void Chip8::OP_Fx15(Instruction ins) {
     // Set delay timer = Vx Fx15: LD DT, Vx
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = ins.x;
 
     delayTimer = registers[Vx];
 }
 
-void Chip8::OP_Fx18() {
+void Chip8::OP_Fx18(Instruction ins) {
     // Set sound timer = Vx Fx18: LD ST, Vx
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = ins.x;
 
     soundTimer = registers[Vx];
 }
 
-void Chip8::OP_Fx1E() {
+void Chip8::OP_Fx1E(Instruction ins) {
     // Set index = index + Vx Fx1E: ADD I, Vx
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = ins.x;
 
     index += registers[Vx];
 }
 
-void Chip8::OP_Fx29() {
+void Chip8::OP_Fx29(Instruction ins) {
     // Set index = location of sprite for digit Vx Fx29: LD F, Vx
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = ins.x;
     uint8_t digit = registers[Vx];
 
     index = FONT_START_ADDRESS + (5 * digit);
 }
 
-void Chip8::OP_Fx33() {
+void Chip8::OP_Fx33(Instruction ins) {
     // Store BCD representation of Vx in memory locations I, I+1, and I+2 Fx33: LD B, Vx
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = ins.x;
     uint8_t value = registers[Vx];
 
+    uint8_t digits[3];
+
     // Ones place
-    memory[index + 2] = value % 10;
+    digits[2] = value % 10;
     value /= 10;
 
     // Tens place
-    memory[index + 1] = value % 10;
+    digits[1] = value % 10;
     value /= 10;
 
     // Hundreds place
-    memory[index] = value % 10;
+    digits[0] = value % 10;
+
+    // The ROM may have just overwritten its own code, rewriting the same bytes changes nothing
+    if (memcmp(&memory[index], digits, sizeof(digits)) != 0) {
+        memcpy(&memory[index], digits, sizeof(digits));
+        InvalidateDecodeCache(index, sizeof(digits));
+    }
 }
 
-void Chip8::OP_Fx55() {
+template <uint8_t Quirks>
+void Chip8::OP_Fx55(Instruction ins) {
     // Store registers V0 through Vx in memory starting at location I Fx55: LD [I], Vx
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = ins.x;
+    bool changed = false;
 
     for (uint8_t i = 0; i <= Vx; ++i) {
+        changed |= memory[index + i] != registers[i];
         memory[index + i] = registers[i];
     }
+
+    // The ROM may have just overwritten its own code, rewriting the same bytes changes nothing
+    if (changed) {
+        InvalidateDecodeCache(index, Vx + 1);
+    }
+
+    if (Quirks & QUIRK_LOAD_STORE_I) {
+        index += Vx + 1;
+    }
 }
 
-void Chip8::OP_Fx65() {
+template <uint8_t Quirks>
+void Chip8::OP_Fx65(Instruction ins) {
     // Read registers V0 through Vx from memory starting at location I Fx65: LD Vx, [I]
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = ins.x;
 
     for (uint8_t i = 0; i <= Vx; ++i) {
         registers[i] = memory[index + i];
     }
+
+    // The COSMAC VIP advanced I while it copied
+    if (Quirks & QUIRK_LOAD_STORE_I) {
+        index += Vx + 1;
+    }
 }
 
-void Chip8::Table0()
+void Chip8::Table0(Instruction ins)
 {
-	((*this).*(table0[opcode & 0x000Fu]))();
+	((*this).*(table0[ins.n()]))(ins);
 }
 
-void Chip8::Table8()
+void Chip8::Table8(Instruction ins)
 {
-	((*this).*(table8[opcode & 0x000Fu]))();
+	((*this).*(table8[ins.n()]))(ins);
 }
 
-void Chip8::TableE()
+void Chip8::TableE(Instruction ins)
 {
-	((*this).*(tableE[opcode & 0x000Fu]))();
+	((*this).*(tableE[ins.n()]))(ins);
 }
 
-void Chip8::TableF()
+void Chip8::TableF(Instruction ins)
 {
-	((*this).*(tableF[opcode & 0x00FFu]))();
+	((*this).*(tableF[ins.kk]))(ins);
 }
 
-void Chip8::OP_NULL()
+void Chip8::OP_NULL(Instruction)
 {}
 
+uint8_t Chip8::opTable[0x10000];
+Chip8::Chip8Func Chip8::table[0xF + 1];
+Chip8::Chip8Func Chip8::table0[0xE + 1];
+Chip8::Chip8Func Chip8::table8[0xE + 1];
+Chip8::Chip8Func Chip8::tableE[0xE + 1];
+Chip8::Chip8Func Chip8::tableF[0x65 + 1];
+
+Chip8::Chip8Func Chip8::opHandlers[QUIRK_PROFILES][OP_ID_COUNT];
+Chip8::RunBlockFunc Chip8::blockRunners[QUIRK_PROFILES];
+
+// Fills the handler table and block runner of one quirk profile, then the next one, so every combination is compiled
+template <uint8_t Quirks>
+struct QuirkTables {
+    static void Build() {
+        static Chip8::Chip8Func const handlers[OP_ID_COUNT] = {
+            &Chip8::OP_NULL,
+            &Chip8::OP_00E0,
+            &Chip8::OP_00EE,
+            &Chip8::OP_1nnn,
+            &Chip8::OP_2nnn,
+            &Chip8::OP_3xkk,
+            &Chip8::OP_4xkk,
+            &Chip8::OP_5xy0,
+            &Chip8::OP_6xkk,
+            &Chip8::OP_7xkk,
+            &Chip8::OP_8xy0,
+            &Chip8::OP_8xy1,
+            &Chip8::OP_8xy2,
+            &Chip8::OP_8xy3,
+            &Chip8::OP_8xy4,
+            &Chip8::OP_8xy5,
+            &Chip8::OP_8xy6<Quirks>,
+            &Chip8::OP_8xy7,
+            &Chip8::OP_8xyE<Quirks>,
+            &Chip8::OP_9xy0,
+            &Chip8::OP_Annn,
+            &Chip8::OP_Bnnn<Quirks>,
+            &Chip8::OP_Cxkk,
+            &Chip8::OP_Dxyn<Quirks>,
+            &Chip8::OP_Ex9E,
+            &Chip8::OP_ExA1,
+            &Chip8::OP_Fx07,
+            &Chip8::OP_Fx0A,
+            &Chip8::OP_Fx15,
+            &Chip8::OP_Fx18,
+            &Chip8::OP_Fx1E,
+            &Chip8::OP_Fx29,
+            &Chip8::OP_Fx33,
+            &Chip8::OP_Fx55<Quirks>,
+            &Chip8::OP_Fx65<Quirks>
+        };
+
+        for (unsigned int op = 0; op < OP_ID_COUNT; ++op) {
+            Chip8::opHandlers[Quirks][op] = handlers[op];
+        }
+
+        Chip8::blockRunners[Quirks] = &Chip8::RunBlock<Quirks>;
+        QuirkTables<Quirks + 1>::Build();
+    }
+};
+
+template <>
+struct QuirkTables<QUIRK_PROFILES> {
+    static void Build() {}
+};
+
+uint8_t Chip8::DecodeOp(uint16_t opcode) {
+    // Same decoding rules as table/table0/table8/tableE/tableF, resolved down to the final handler
+    switch ((opcode & 0xF000u) >> 12u) {
+        case 0x0:
+            switch (opcode & 0x000Fu) {
+                case 0x0: return OP_ID_00E0;
+                case 0xE: return OP_ID_00EE;
+            }
+            break;
+        case 0x1: return OP_ID_1nnn;
+        case 0x2: return OP_ID_2nnn;
+        case 0x3: return OP_ID_3xkk;
+        case 0x4: return OP_ID_4xkk;
+        case 0x5: return OP_ID_5xy0;
+        case 0x6: return OP_ID_6xkk;
+        case 0x7: return OP_ID_7xkk;
+        case 0x8:
+            switch (opcode & 0x000Fu) {
+                case 0x0: return OP_ID_8xy0;
+                case 0x1: return OP_ID_8xy1;
+                case 0x2: return OP_ID_8xy2;
+                case 0x3: return OP_ID_8xy3;
+                case 0x4: return OP_ID_8xy4;
+                case 0x5: return OP_ID_8xy5;
+                case 0x6: return OP_ID_8xy6;
+                case 0x7: return OP_ID_8xy7;
+                case 0xE: return OP_ID_8xyE;
+            }
+            break;
+        case 0x9: return OP_ID_9xy0;
+        case 0xA: return OP_ID_Annn;
+        case 0xB: return OP_ID_Bnnn;
+        case 0xC: return OP_ID_Cxkk;
+        case 0xD: return OP_ID_Dxyn;
+        case 0xE:
+            switch (opcode & 0x000Fu) {
+                case 0x1: return OP_ID_ExA1;
+                case 0xE: return OP_ID_Ex9E;
+            }
+            break;
+        case 0xF:
+            switch (opcode & 0x00FFu) {
+                case 0x07: return OP_ID_Fx07;
+                case 0x0A: return OP_ID_Fx0A;
+                case 0x15: return OP_ID_Fx15;
+                case 0x18: return OP_ID_Fx18;
+                case 0x1E: return OP_ID_Fx1E;
+                case 0x29: return OP_ID_Fx29;
+                case 0x33: return OP_ID_Fx33;
+                case 0x55: return OP_ID_Fx55;
+                case 0x65: return OP_ID_Fx65;
+            }
+            break;
+    }
+
+    return OP_ID_NULL;
+}
+
+bool Chip8::BuildOpTable() {
+    for (uint32_t opcode = 0; opcode <= 0xFFFFu; ++opcode) {
+        opTable[opcode] = DecodeOp(static_cast<uint16_t>(opcode));
+    }
+
+    QuirkTables<0>::Build();
+
+    // Setup the nested function pointer tables
+    table[0x0] = &Chip8::Table0;
+    table[0x1] = &Chip8::OP_1nnn;
+    table[0x2] = &Chip8::OP_2nnn;
+    table[0x3] = &Chip8::OP_3xkk;
+    table[0x4] = &Chip8::OP_4xkk;
+    table[0x5] = &Chip8::OP_5xy0;
+    table[0x6] = &Chip8::OP_6xkk;
+    table[0x7] = &Chip8::OP_7xkk;
+    table[0x8] = &Chip8::Table8;
+    table[0x9] = &Chip8::OP_9xy0;
+    table[0xA] = &Chip8::OP_Annn;
+    table[0xB] = &Chip8::OP_Bnnn<0>;
+    table[0xC] = &Chip8::OP_Cxkk;
+    table[0xD] = &Chip8::OP_Dxyn<0>;
+    table[0xE] = &Chip8::TableE;
+    table[0xF] = &Chip8::TableF;
+
+    for (size_t i = 0; i <= 0xE; i++)
+    {
+        table0[i] = &Chip8::OP_NULL;
+        table8[i] = &Chip8::OP_NULL;
+        tableE[i] = &Chip8::OP_NULL;
+    }
+
+    table0[0x0] = &Chip8::OP_00E0;
+    table0[0xE] = &Chip8::OP_00EE;
+
+    table8[0x0] = &Chip8::OP_8xy0;
+    table8[0x1] = &Chip8::OP_8xy1;
+    table8[0x2] = &Chip8::OP_8xy2;
+    table8[0x3] = &Chip8::OP_8xy3;
+    table8[0x4] = &Chip8::OP_8xy4;
+    table8[0x5] = &Chip8::OP_8xy5;
+    table8[0x6] = &Chip8::OP_8xy6<0>;
+    table8[0x7] = &Chip8::OP_8xy7;
+    table8[0xE] = &Chip8::OP_8xyE<0>;
+
+    tableE[0x1] = &Chip8::OP_ExA1;
+    tableE[0xE] = &Chip8::OP_Ex9E;
+
+    for (size_t i = 0; i <= 0x65; i++)
+    {
+        tableF[i] = &Chip8::OP_NULL;
+    }
+
+    tableF[0x07] = &Chip8::OP_Fx07;
+    tableF[0x0A] = &Chip8::OP_Fx0A;
+    tableF[0x15] = &Chip8::OP_Fx15;
+    tableF[0x18] = &Chip8::OP_Fx18;
+    tableF[0x1E] = &Chip8::OP_Fx1E;
+    tableF[0x29] = &Chip8::OP_Fx29;
+    tableF[0x33] = &Chip8::OP_Fx33;
+    tableF[0x55] = &Chip8::OP_Fx55<0>;
+    tableF[0x65] = &Chip8::OP_Fx65<0>;
+
+    return true;
+    /*
+    - the nested tables need two indirect calls for 0x0, 0x8, 0xE and 0xF opcodes (table -> TableX -> handler)
+    - opTable resolves every possible 16-bit opcode once, so Cycle() does a single indirect call
+    - it is 64 KB of handler ids shared by all instances instead of 64K member function pointers (1 MB)
+    - opcodes the nested tables would index out of bounds (e.g. 0x8xyF, 0xFxFF) map to OP_NULL here
+    */
+}
+
+Instruction Chip8::Decode(uint16_t opcode) {
+    Instruction ins;
+
+    ins.op = opTable[opcode];
+    ins.x = (opcode & 0x0F00u) >> 8u;
+    ins.y = (opcode & 0x00F0u) >> 4u;
+    ins.kk = opcode & 0x00FFu;
+
+    return ins;
+    /*
+    - (opcode & 0x0F00u) >> 8u isolates bits 8-11 and shifts them down to get the Vx register index
+    - (opcode & 0x00F0u) >> 4u isolates bits 4-7 and shifts them down to get the Vy register index
+    - opcode & 0x00FFu is the last byte (kk), used as an immediate value
+    - the last nibble (n, the sprite height of Dxyn) and the last 12 bits (nnn, an address) are rebuilt from kk and x
+      by Instruction::n() and nnn(), which keeps an Instruction at 4 bytes
+    - every handler gets all fields and just reads the ones it needs, so no handler masks or shifts the opcode itself
+    */
+}
+
+void Chip8::InvalidateDecodeCache(uint16_t address, uint16_t length) {
+    if (length == 0) {
+        return;
+    }
+
+    unsigned int first = address / 2u;
+    unsigned int last = (address + length - 1u) / 2u;
+
+    for (unsigned int i = first; i <= last && i < sizeof(decodeCache) / sizeof(decodeCache[0]); ++i) {
+        decodeCache[i].op = OP_ID_UNDECODED;
+    }
+
+    // Lets translators outside the core (the JIT) notice a write to code they compiled
+    for (unsigned int byte = address; byte < address + length && byte < sizeof(memory); ++byte) {
+        if (watched[byte / 8u] & (1u << (byte % 8u))) {
+            ++codeWrites;
+            break;
+        }
+    }
+
+    // Any block that could reach the written bytes has to be rebuilt as well
+    unsigned int firstBlock = first >= MAX_BLOCK_LENGTH ? first - MAX_BLOCK_LENGTH + 1 : 0;
+
+    for (unsigned int i = firstBlock; i <= last && i < sizeof(blockLength); ++i) {
+        blockLength[i] = 0;
+    }
+
+    /*
+    - entry i holds the instruction made of memory[2 * i] and memory[2 * i + 1]
+    - a write to any byte of that pair makes the entry stale, so it is decoded again the next time it runs
+    - a block is at most MAX_BLOCK_LENGTH instructions, so only blocks starting that close before the write can contain it
+    - translated code is watched by address, not through decodeCache: an earlier write nearby may already have
+      dropped its entries, and a later write that really changes it would then go unnoticed
+    */
+}
+
+void Chip8::SetState(Chip8State const& state) {
+    RestoreState(reinterpret_cast<uint8_t const*>(&state));
+}
+
+void Chip8::RestoreState(uint8_t const* bytes) {
+    uint8_t const* newMemory = bytes + offsetof(Chip8State, memory);
+
+    // Only the 64-byte chunks of memory that differ can hold stale decoded code
+    for (unsigned int chunk = 0; chunk < sizeof(memory); chunk += 64) {
+        if (memcmp(memory + chunk, newMemory + chunk, 64) != 0) {
+            InvalidateDecodeCache(static_cast<uint16_t>(chunk), 64);
+        }
+    }
+
+    memcpy(static_cast<void*>(static_cast<Chip8State*>(this)), bytes, CHIP8_STATE_BYTES);
+    /*
+    - machines forked from the same ROM share almost all of their memory, so restoring one keeps most of the decode cache
+    - one memcpy of the state, the caches, breakpoints and engine choice stay with this Chip8
+    - the copy stops at the end of memory, the tail padding of Chip8State already belongs to decodeCache
+    */
+}
+
+void Chip8::SaveState(void* buffer) const {
+    SaveStateHeader header = {{'C', '8', 'S', 'S'}, SAVE_STATE_VERSION, quirks, 0, CHIP8_STATE_BYTES};
+
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(static_cast<uint8_t*>(buffer) + sizeof(header), static_cast<Chip8State const*>(this), CHIP8_STATE_BYTES);
+}
+
+bool Chip8::LoadState(void const* buffer, size_t size) {
+    SaveStateHeader header;
+
+    if (size != SAVE_STATE_SIZE) {
+        return false;
+    }
+
+    memcpy(&header, buffer, sizeof(header));
+
+    if (memcmp(header.magic, "C8SS", 4) != 0 || header.version != SAVE_STATE_VERSION
+            || header.stateBytes != CHIP8_STATE_BYTES || header.quirks >= QUIRK_PROFILES) {
+        return false;
+    }
+
+    uint8_t const* payload = static_cast<uint8_t const*>(buffer) + sizeof(header);
+    Chip8State state;
+    memcpy(static_cast<void*>(&state), payload, CHIP8_STATE_BYTES);
+
+    if (state.instructionsPerSecond == 0 || state.sp > 16 || state.pc > 0xFFEu || state.index > 0xFFFu) {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < state.sp; ++i) {
+        if (state.stack[i] > 0xFFEu) {
+            return false;
+        }
+    }
+
+    RestoreState(payload);
+    SetQuirks(header.quirks);
+    return true;
+    /*
+    - the payload is the in-memory layout of Chip8State, so saving and loading are one memcpy each plus the header
+    - the version, size and magic are what guard against states from another build or host
+    - the fields the core divides by (instructionsPerSecond) or indexes with (sp, pc, index and the return
+      addresses 00EE will load) are range-checked, everything else is data any value of which is valid
+    */
+}
+
+Chip8State const& Chip8::State() const {
+    return *this;
+}
+
+void Chip8::SetQuirks(uint8_t profile) {
+    quirks = profile % QUIRK_PROFILES;
+    handlers = opHandlers[quirks];
+    runBlock = blockRunners[quirks];
+}
+
+bool ParseQuirks(char const* text, uint8_t& quirks) {
+    static struct {
+        char const* name;
+        uint8_t quirks;
+    } const profiles[] = {
+        {"modern", 0},
+        {"cosmac", QUIRK_SHIFT_VY | QUIRK_LOAD_STORE_I},
+        {"schip", QUIRK_JUMP_VX},
+        {"xochip", QUIRK_SHIFT_VY | QUIRK_LOAD_STORE_I | QUIRK_WRAP_SPRITES}
+    };
+
+    for (unsigned int i = 0; i < sizeof(profiles) / sizeof(profiles[0]); ++i) {
+        if (strcmp(text, profiles[i].name) == 0) {
+            quirks = profiles[i].quirks;
+            return true;
+        }
+    }
+
+    char* end;
+    unsigned long value = strtoul(text, &end, 0);
+
+    if (*text == '\0' || *end != '\0' || value >= QUIRK_PROFILES) {
+        return false;
+    }
+
+    quirks = static_cast<uint8_t>(value);
+    return true;
+    /*
+    - modern is what this core always did: shifts in place, I unchanged, Bnnn from V0, sprites clipped
+    - cosmac is the original VIP interpreter, schip is SUPER-CHIP 1.1 and xochip is Octo's XO-CHIP
+    - a number picks the QuirkFlags bits directly, e.g. 0x5 for shifts from Vy with Bxnn jumps
+    */
+}
+
+bool ParseNumber(char const* text, uint64_t max, uint64_t& value) {
+    // strtoull() would also take leading blanks, signs and a negative number wrapped around
+    if (text[0] < '0' || text[0] > '9') {
+        return false;
+    }
+
+    char* end;
+    errno = 0;
+    value = strtoull(text, &end, 10);
+
+    return *end == '\0' && errno != ERANGE && value <= max;
+}
+
 void Chip8::Cycle() {
-    // fetch
-    opcode = (memory[pc] << 8u) | memory[pc + 1];
+    Instruction ins;
+
+    // fetch and decode, from the cache whenever pc is even and inside memory
+    if ((pc & 0xF001u) == 0) {
+        Instruction& cached = decodeCache[pc >> 1u];
+
+        if (cached.op == OP_ID_UNDECODED) {
+            cached = Decode((memory[pc] << 8u) | memory[pc + 1]);
+        }
+
+        ins = cached;
+    } else {
+        ins = Decode((memory[pc] << 8u) | memory[pc + 1]);
+    }
 
     // increment program counter
     pc += 2;
 
-    // decode and execute
-    ((*this).*(table[(opcode & 0xF000u) >> 12u]))();
+    // execute with a single lookup in the flat table
+    ((*this).*(handlers[ins.op]))(ins);
+    // update timers
+    TickTimers(1);
+}
+
+void Chip8::CycleNested() {
+    // Original two-level dispatch without the decode cache, kept as the baseline for benchmarks and differential checks
+    // It always runs the modern profile (quirks 0)
+    uint16_t opcode = (memory[pc] << 8u) | memory[pc + 1];
+
+    pc += 2;
+
+    ((*this).*(table[(opcode & 0xF000u) >> 12u]))(Decode(opcode));
 
     // update timers
-    if (delayTimer > 0) {
-        --delayTimer;
+    TickTimers(1);
+}
+
+bool Chip8::EndsBlock(uint8_t op) {
+    switch (op) {
+        case OP_ID_00EE:
+        case OP_ID_1nnn:
+        case OP_ID_2nnn:
+        case OP_ID_Bnnn:
+        case OP_ID_3xkk:
+        case OP_ID_4xkk:
+        case OP_ID_5xy0:
+        case OP_ID_9xy0:
+        case OP_ID_Ex9E:
+        case OP_ID_ExA1:
+        case OP_ID_Fx0A:
+            return true;
+    }
+
+    return false;
+    /*
+    - jumps, calls and returns move pc somewhere else
+    - skips may move pc past the next instruction
+    - Fx0A moves pc back onto itself while no key is pressed
+    - every other instruction just falls through to pc + 2
+    */
+}
+
+uint8_t Chip8::BlockLength(uint16_t address) {
+    uint8_t& length = blockLength[address >> 1u];
+
+    if (length == 0) {
+        unsigned int i = address >> 1u;
+
+        while (length < MAX_BLOCK_LENGTH && i < sizeof(blockLength)) {
+            Instruction& ins = decodeCache[i];
+
+            if (ins.op == OP_ID_UNDECODED) {
+                ins = Decode((memory[2 * i] << 8u) | memory[2 * i + 1]);
+            }
+
+            // Fx0A always starts a block of its own, so Run() sees a key wait before anything executes it
+            if (ins.op == OP_ID_Fx0A && length > 0) {
+                break;
+            }
+
+            ++length;
+            ++i;
+
+            if (EndsBlock(ins.op)) {
+                break;
+            }
+        }
+    }
+
+    return length;
+    /*
+    - a block is the run of instructions from address up to and including the first one that ends a block
+    - the instructions themselves stay in decodeCache, a block is only its start address and length
+    */
+}
+
+void Chip8::TickTimers(unsigned int cycles) {
+    // Advance the emulated clock by the given number of executed cycles
+    elapsedCycles += cycles;
+
+    uint64_t phase = timerPhase + static_cast<uint64_t>(cycles) * TIMER_HZ;
+
+    if (phase < instructionsPerSecond) {
+        timerPhase = static_cast<uint32_t>(phase);
+        return;
+    }
+
+    uint64_t ticks = phase / instructionsPerSecond;
+    timerPhase = static_cast<uint32_t>(phase - ticks * instructionsPerSecond);
+
+    delayTimer = delayTimer > ticks ? delayTimer - ticks : 0;
+    soundTimer = soundTimer > ticks ? soundTimer - ticks : 0;
+    /*
+    - the timers tick TIMER_HZ times per instructionsPerSecond cycles, whatever speed the host runs at
+    - the fraction of a tick left over stays in timerPhase, so calling this once with n or n times with 1 gives the same result
+    - the division only happens on cycles that cross a tick
+    */
+}
+
+uint64_t Chip8::TicksAfter(uint64_t cycles) const {
+    // How many timer ticks the next cycles would produce
+    return (timerPhase + cycles * TIMER_HZ) / instructionsPerSecond;
+}
+
+template <uint8_t Quirks>
+uint8_t Chip8::RunBlock(uint16_t address, uint8_t count) {
+    Instruction const* block = &decodeCache[address >> 1u];
+    unsigned int pendingTicks = 0;
+    uint8_t executed = 0;
+
+    // Only the last instruction of a block can read or change pc, so set it once up front
+    pc = address + 2 * count;
+
+    while (executed < count) {
+        Instruction ins = block[executed];
+        ++executed;
+
+        switch (ins.op) {
+            case OP_ID_00E0: OP_00E0(ins); break;
+            case OP_ID_00EE: OP_00EE(ins); break;
+            case OP_ID_1nnn: OP_1nnn(ins); break;
+            case OP_ID_2nnn: OP_2nnn(ins); break;
+            case OP_ID_3xkk: OP_3xkk(ins); break;
+            case OP_ID_4xkk: OP_4xkk(ins); break;
+            case OP_ID_5xy0: OP_5xy0(ins); break;
+            case OP_ID_6xkk: OP_6xkk(ins); break;
+            case OP_ID_7xkk: OP_7xkk(ins); break;
+            case OP_ID_8xy0: OP_8xy0(ins); break;
+            case OP_ID_8xy1: OP_8xy1(ins); break;
+            case OP_ID_8xy2: OP_8xy2(ins); break;
+            case OP_ID_8xy3: OP_8xy3(ins); break;
+            case OP_ID_8xy4: OP_8xy4(ins); break;
+            case OP_ID_8xy5: OP_8xy5(ins); break;
+            case OP_ID_8xy6: OP_8xy6<Quirks>(ins); break;
+            case OP_ID_8xy7: OP_8xy7(ins); break;
+            case OP_ID_8xyE: OP_8xyE<Quirks>(ins); break;
+            case OP_ID_9xy0: OP_9xy0(ins); break;
+            case OP_ID_Annn: OP_Annn(ins); break;
+            case OP_ID_Bnnn: OP_Bnnn<Quirks>(ins); break;
+            case OP_ID_Cxkk: OP_Cxkk(ins); break;
+            case OP_ID_Dxyn: OP_Dxyn<Quirks>(ins); break;
+            case OP_ID_Ex9E: OP_Ex9E(ins); break;
+            case OP_ID_ExA1: OP_ExA1(ins); break;
+            case OP_ID_Fx0A: OP_Fx0A(ins); break;
+            case OP_ID_Fx1E: OP_Fx1E(ins); break;
+            case OP_ID_Fx29: OP_Fx29(ins); break;
+            case OP_ID_Fx65: OP_Fx65<Quirks>(ins); break;
+
+            // Timer instructions need the decrements of the earlier instructions applied first
+            case OP_ID_Fx07: TickTimers(pendingTicks); pendingTicks = 0; OP_Fx07(ins); break;
+            case OP_ID_Fx15: TickTimers(pendingTicks); pendingTicks = 0; OP_Fx15(ins); break;
+            case OP_ID_Fx18: TickTimers(pendingTicks); pendingTicks = 0; OP_Fx18(ins); break;
+
+            // Stores may overwrite the rest of this block, stop right after them if they did
+            case OP_ID_Fx33:
+            case OP_ID_Fx55:
+                if (ins.op == OP_ID_Fx33) {
+                    OP_Fx33(ins);
+                } else {
+                    OP_Fx55<Quirks>(ins);
+                }
+
+                if (blockLength[address >> 1u] == 0) {
+                    pc = address + 2 * executed;
+                    count = executed;
+                }
+                break;
+
+            default: break;
+        }
+
+        ++pendingTicks;
+    }
+
+    TickTimers(pendingTicks);
+
+    return executed;
+    /*
+    - the block runs as one tight loop: no fetch, no cache check and no pc update per instruction
+    - the switch calls each OP_* directly, so the compiler can inline the handlers instead of an indirect call
+    - compiled once per quirk profile, the quirk tests inside the handlers are constants and fold away
+    - timers are advanced in bulk, which gives the same values as Cycle() because only Fx07/Fx15/Fx18 look at them
+    */
+}
+
+void Chip8::Render(uint32_t* pixels) const {
+    videoKernels->expand(video, pixels);
+}
+
+uint32_t Chip8::SkipIdle(uint32_t cycles) {
+    if ((pc & 0xF001u) != 0) {
+        return 0;
     }
 
-    if (soundTimer > 0) {
-        if (soundTimer == 1) {
-            // Beep
-            // std::cout << "BEEP!" << std::endl;
+    Instruction& ins = decodeCache[pc >> 1u];
+
+    if (ins.op == OP_ID_UNDECODED) {
+        ins = Decode((memory[pc] << 8u) | memory[pc + 1]);
+    }
+
+    uint32_t skipped = 0;
+
+    switch (ins.op) {
+        case OP_ID_1nnn:
+            // Jump to itself: nothing but the timers can change any more
+            if (ins.nnn() == pc) {
+                skipped = cycles;
+            }
+            break;
+
+        case OP_ID_Fx0A: {
+            // The keypad only changes between Run() calls, so with no key held the wait lasts the whole budget
+            bool keyPress = false;
+
+            for (int i = 0; i < 16; ++i) {
+                keyPress |= keypad[i] != 0;
+            }
+
+            if (!keyPress) {
+                skipped = cycles;
+            }
+            break;
         }
-        --soundTimer;
+
+        case OP_ID_Fx07: {
+            // Fx07, 3x00, 1nnn back to the Fx07: spin until the delay timer reads 0
+            if (pc > sizeof(memory) - 6) {
+                break;
+            }
+
+            Instruction test = Decode((memory[pc + 2] << 8u) | memory[pc + 3]);
+            Instruction loop = Decode((memory[pc + 4] << 8u) | memory[pc + 5]);
+
+            if (test.op != OP_ID_3xkk || test.x != ins.x || test.kk != 0 || loop.op != OP_ID_1nnn || loop.nnn() != pc) {
+                break;
+            }
+
+            // timerPhase is only out of range right after instructionsPerSecond changed, let Cycle() settle it
+            if (delayTimer == 0 || timerPhase >= instructionsPerSecond) {
+                break;
+            }
+
+            // Every pass takes 3 cycles and loops again as long as Fx07 read a non-zero value,
+            // which is every pass that starts before the delay timer has ticked down to 0
+            uint64_t untilZero = (static_cast<uint64_t>(delayTimer) * instructionsPerSecond - timerPhase + TIMER_HZ - 1) / TIMER_HZ;
+            uint64_t passes = (untilZero + 2u) / 3u;
+
+            if (passes > cycles / 3u) {
+                passes = cycles / 3u;
+            }
+
+            if (passes > 0) {
+                registers[ins.x] = static_cast<uint8_t>(delayTimer - TicksAfter(3u * (passes - 1u)));
+                skipped = static_cast<uint32_t>(3u * passes);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    if (skipped == 0) {
+        return 0;
     }
-}
\ No newline at end of file
+
+    TickTimers(skipped);
+    skippedCycles += skipped;
+
+    return skipped;
+    /*
+    - returns how many cycles of the budget were consumed without executing them, 0 when pc is not in an idle loop
+    - nothing is written when nothing was skipped: skippedCycles lies outside the state page, and a store on every
+      Run() would give each SharedRomPool instance a private copy of a second page
+    - the state afterwards is exactly what executing those cycles one by one would have produced
+    - the delay wait stops short of its last pass, which then runs normally and falls out of the loop
+    */
+}
+
+RunResult Chip8::Run(uint32_t cycles, uint8_t stops) {
+    RunResult result = {0, StopReason::Budget};
+
+    if (stops & STOP_ON_FRAME) {
+        uint32_t untilTick = CyclesToNextTick();
+
+        if (untilTick <= cycles) {
+            cycles = untilTick;
+            result.reason = StopReason::Frame;
+        }
+    }
+
+    // Breakpoints need every instruction to be looked at, so they switch to stepping and turn idle skipping off
+    bool step = engine == Engine::Interpreter || breakpointCount > 0;
+    bool skip = skipIdle && breakpointCount == 0;
+
+    while (result.cycles < cycles) {
+        // Not on the first instruction, so calling Run() again continues from a breakpoint
+        if (breakpointCount > 0 && result.cycles > 0 && IsBreakpoint(pc)) {
+            result.reason = StopReason::Breakpoint;
+            return result;
+        }
+
+        if ((stops & STOP_ON_KEY_WAIT) && WaitingForKey()) {
+            result.reason = StopReason::KeyWait;
+            return result;
+        }
+
+        uint32_t skipped = skip ? SkipIdle(cycles - result.cycles) : 0;
+
+        if (skipped > 0) {
+            result.cycles += skipped;
+            continue;
+        }
+
+        // Odd or out of range pc cannot start a block
+        if (step || (pc & 0xF001u) != 0) {
+            Cycle();
+            ++result.cycles;
+            continue;
+        }
+
+        uint8_t length = BlockLength(pc);
+
+        // Stop part way through the block if the budget runs out
+        if (length > cycles - result.cycles) {
+            length = static_cast<uint8_t>(cycles - result.cycles);
+        }
+
+        result.cycles += ((*this).*runBlock)(pc, length);
+    }
+
+    return result;
+    /*
+    - idle loops and Fx0A always sit at the start of a block, so checking between blocks is enough
+    - a frame ends with the cycle that makes the timers tick, the budget is cut down to that cycle up front
+    */
+}
+
+void Chip8::SetBreakpoint(uint16_t address, bool enabled) {
+    uint8_t& bits = breakpoints[(address & 0xFFFu) >> 3u];
+    uint8_t mask = 1u << (address & 7u);
+
+    if (enabled != ((bits & mask) != 0)) {
+        bits ^= mask;
+        breakpointCount += enabled ? 1 : -1;
+    }
+}
+
+bool Chip8::IsBreakpoint(uint16_t address) const {
+    return address < sizeof(memory) && ((breakpoints[address >> 3u] >> (address & 7u)) & 1u);
+}
+
+bool Chip8::WaitingForKey() {
+    if ((pc & 0xF001u) != 0) {
+        return false;
+    }
+
+    Instruction& ins = decodeCache[pc >> 1u];
+
+    if (ins.op == OP_ID_UNDECODED) {
+        ins = Decode((memory[pc] << 8u) | memory[pc + 1]);
+    }
+
+    if (ins.op != OP_ID_Fx0A) {
+        return false;
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        if (keypad[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t Chip8::CyclesToNextTick() const {
+    // The cycle that pushes timerPhase up to instructionsPerSecond is the one that ticks
+    if (timerPhase >= instructionsPerSecond) {
+        return 1;
+    }
+
+    return (instructionsPerSecond - timerPhase + TIMER_HZ - 1) / TIMER_HZ;
+}
+
+char const* RomStatusText(RomStatus status) {
+    switch (status) {
+        case RomStatus::Loaded: return "loaded";
+        case RomStatus::Unreadable: return "cannot be read";
+        case RomStatus::Empty: return "is empty";
+        case RomStatus::TooLarge: return "does not fit in memory (3584 bytes at most)";
+    }
+
+    return "unknown status";
+}
+
+// 128-bit product of a and b with its halves folded together
+static inline uint64_t FoldedMultiply(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+    // Schoolbook multiply of the 32-bit halves, for compilers without a 128-bit type (MSVC)
+    uint64_t aLow = a & 0xFFFFFFFFu, aHigh = a >> 32u;
+    uint64_t bLow = b & 0xFFFFFFFFu, bHigh = b >> 32u;
+    uint64_t lowLow = aLow * bLow;
+    uint64_t lowHigh = aLow * bHigh;
+    uint64_t highLow = aHigh * bLow;
+    uint64_t highHigh = aHigh * bHigh;
+    uint64_t middle = (lowLow >> 32u) + (lowHigh & 0xFFFFFFFFu) + (highLow & 0xFFFFFFFFu);
+    uint64_t low = (middle << 32u) | (lowLow & 0xFFFFFFFFu);
+    uint64_t high = highHigh + (lowHigh >> 32u) + (highLow >> 32u) + (middle >> 32u);
+    return low ^ high;
+#endif
+}
+
+uint64_t HashROM(uint8_t const* data, size_t size) {
+    const uint64_t KEY0 = 0xA0761D6478BD642Full;
+    const uint64_t KEY1 = 0xE7037ED1A0B428DBull;
+    const uint64_t KEY2 = 0x8EBC6AF09C88C6E3ull;
+    const uint64_t KEY3 = 0x589965CC75374CC3ull;
+
+    uint64_t hash = KEY0 ^ size;
+    size_t whole = size & ~static_cast<size_t>(15);
+
+    // One multiply per 16 bytes
+    for (size_t i = 0; i < whole; i += 16) {
+        uint64_t a, b;
+        memcpy(&a, data + i, 8);
+        memcpy(&b, data + i + 8, 8);
+        hash = FoldedMultiply(a ^ KEY1, b ^ hash);
+    }
+
+    // The last 1-15 bytes, zero padded
+    if (whole < size) {
+        uint64_t tail[2] = {};
+        memcpy(tail, data + whole, size - whole);
+        hash = FoldedMultiply(tail[0] ^ KEY1, tail[1] ^ hash);
+    }
+
+    return FoldedMultiply(hash ^ KEY2, size ^ KEY3);
+    /*
+    - the core of wyhash: 16 bytes are read as two words and folded into the hash with one 64x64 multiply,
+      about 0.5 us for a full 3584-byte ROM where byte-wise FNV-1a takes about 5 us
+    - the words are read in host byte order, hashes only match between hosts of the same (little) endianness
+    - the size goes in first and last, so zero padding cannot make two ROMs of different length collide
+    - not cryptographic, it tells ROMs apart, it does not defend against someone crafting collisions
+    */
+}
+
+// Generated code (chip8-aot) calls the quirk handlers of its profile directly, so every combination is exported
+#define CHIP8_QUIRK_HANDLERS(Q) \
+    template void Chip8::OP_8xy6<Q>(Instruction); \
+    template void Chip8::OP_8xyE<Q>(Instruction); \
+    template void Chip8::OP_Bnnn<Q>(Instruction); \
+    template void Chip8::OP_Dxyn<Q>(Instruction); \
+    template void Chip8::OP_Fx55<Q>(Instruction); \
+    template void Chip8::OP_Fx65<Q>(Instruction);
+
+CHIP8_QUIRK_HANDLERS(0) CHIP8_QUIRK_HANDLERS(1) CHIP8_QUIRK_HANDLERS(2) CHIP8_QUIRK_HANDLERS(3)
+CHIP8_QUIRK_HANDLERS(4) CHIP8_QUIRK_HANDLERS(5) CHIP8_QUIRK_HANDLERS(6) CHIP8_QUIRK_HANDLERS(7)
+CHIP8_QUIRK_HANDLERS(8) CHIP8_QUIRK_HANDLERS(9) CHIP8_QUIRK_HANDLERS(10) CHIP8_QUIRK_HANDLERS(11)
+CHIP8_QUIRK_HANDLERS(12) CHIP8_QUIRK_HANDLERS(13) CHIP8_QUIRK_HANDLERS(14) CHIP8_QUIRK_HANDLERS(15)
@@ -0,0 +1,349 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/*
+mimic the Chip8 hardware
+
+CHIP-8 Description
+- 16 8-bit register (V0 - VF)
+    - short term data storage
+    - each register can hold value from 0x00 to 0xFF
+    - VF is used as a flag for some instructions
+- 4K Bytes of Memory
+    - long term data storage
+    - address space is from 0x000 to 0xFFF
+        - 0x000 to 0x1FF: Chip 8 interpreter
+        - 0x050 to 0x0A0: 16 build-in characters
+        - 0x200 to 0xFFF: Program ROM and work RAM
+- 16-bit index register (I)
+    - used to point to locations in memory
+    - can hold value from 0x000 to 0xFFF
+        - we use 16-bit because 8-bit is not enough to address 4KB memory
+- 16-bit program counter (PC)
+    - used to store the currently executing address
+    - can hold value from 0x000 to 0xFFF
+        - we use 16-bit because 8-bit is not enough to address 4KB memory
+- 8-bit stack pointer (SP)
+    - used to point to the topmost level of the stack
+    - can hold value from 0x00 to 0x0F
+- 8-bit delay timer
+    - used to do delay operations
+    - decremented at a rate of 60Hz
+- 8-bit sound timer
+    - used to do sound operations
+    - decremented at a rate of 60Hz
+- 16 input keys
+    - 0x0 to 0xF
+    - used to take input from the user
+- 64*32 pixel monochrome display
+    - used to display graphics
+    - each pixel can be on or off
+    - stored as one uint64_t per row, the leftmost pixel in the highest bit
+*/
+
+const unsigned int START_ADDRESS = 0x200;
+const unsigned int FRONT_SIZE = 80;
+const unsigned int FONT_START_ADDRESS = 0x50;
+const unsigned int VIDEO_WIDTH = 64;
+const unsigned int VIDEO_HEIGHT = 32;
+const unsigned int MAX_BLOCK_LENGTH = 64;
+const unsigned int TIMER_HZ = 60;
+
+// Most cycles per frame the frontends take, they run 60 frames per second and more would wrap instructionsPerSecond
+const uint32_t MAX_CYCLES_PER_FRAME = UINT32_MAX / 60;
+const size_t MAX_ROM_SIZE = 4096 - START_ADDRESS;
+
+// Handler ids for the flat dispatch table, one per OP_* function
+enum OpId : uint8_t {
+    OP_ID_NULL = 0,
+    OP_ID_00E0,
+    OP_ID_00EE,
+    OP_ID_1nnn,
+    OP_ID_2nnn,
+    OP_ID_3xkk,
+    OP_ID_4xkk,
+    OP_ID_5xy0,
+    OP_ID_6xkk,
+    OP_ID_7xkk,
+    OP_ID_8xy0,
+    OP_ID_8xy1,
+    OP_ID_8xy2,
+    OP_ID_8xy3,
+    OP_ID_8xy4,
+    OP_ID_8xy5,
+    OP_ID_8xy6,
+    OP_ID_8xy7,
+    OP_ID_8xyE,
+    OP_ID_9xy0,
+    OP_ID_Annn,
+    OP_ID_Bnnn,
+    OP_ID_Cxkk,
+    OP_ID_Dxyn,
+    OP_ID_Ex9E,
+    OP_ID_ExA1,
+    OP_ID_Fx07,
+    OP_ID_Fx0A,
+    OP_ID_Fx15,
+    OP_ID_Fx18,
+    OP_ID_Fx1E,
+    OP_ID_Fx29,
+    OP_ID_Fx33,
+    OP_ID_Fx55,
+    OP_ID_Fx65,
+    OP_ID_COUNT,
+
+    // Marks a decode cache entry whose memory has not been decoded yet (or was overwritten)
+    OP_ID_UNDECODED = 0xFF
+};
+
+// One decoded instruction: the handler id plus the operand fields pre-extracted from the opcode
+struct Instruction {
+    uint8_t op;    // OpId of the handler
+    uint8_t x;     // Vx register index, bits 8-11
+    uint8_t y;     // Vy register index, bits 4-7
+    uint8_t kk;    // lowest byte, bits 0-7
+
+    uint8_t n() const { return kk & 0x0Fu; }                               // lowest nibble, bits 0-3
+    uint16_t nnn() const { return static_cast<uint16_t>((x << 8u) | kk); } // address, bits 0-11
+};
+
+// Four bytes keep the decode cache of a machine at 8 KB, n and nnn cost a mask or a shift to rebuild
+static_assert(sizeof(Instruction) == 4, "Instruction must stay packed");
+
+// Execution engines selectable at runtime through Chip8::engine
+enum class Engine : uint8_t {
+    Interpreter, // Cycle() one instruction at a time
+    BasicBlock   // straight-line runs between control-flow instructions, see Chip8::RunBlock
+};
+
+// Why Chip8::Run() returned
+enum class StopReason : uint8_t {
+    Budget,    // ran every cycle it was given
+    Frame,     // the 60 Hz timers just ticked (STOP_ON_FRAME)
+    KeyWait,   // pc is on an Fx0A and no key is held (STOP_ON_KEY_WAIT)
+    Breakpoint // pc reached an address marked with SetBreakpoint()
+};
+
+// Optional stops for Chip8::Run(), breakpoints always stop
+enum StopFlags : uint8_t {
+    STOP_ON_FRAME = 1u << 0,
+    STOP_ON_KEY_WAIT = 1u << 1
+};
+
+// Behaviour that differs between CHIP-8 interpreters, a profile is any combination of these bits
+enum QuirkFlags : uint8_t {
+    QUIRK_SHIFT_VY = 1u << 0,     // 8xy6/8xyE shift Vy into Vx instead of shifting Vx in place
+    QUIRK_LOAD_STORE_I = 1u << 1, // Fx55/Fx65 leave I pointing past the last register
+    QUIRK_JUMP_VX = 1u << 2,      // Bnnn jumps to nnn + Vx (x is the top nibble of nnn) instead of nnn + V0
+    QUIRK_WRAP_SPRITES = 1u << 3  // Dxyn wraps sprites around the edges instead of clipping them
+};
+
+// Every combination gets its own compiled handlers, see Chip8::SetQuirks()
+const unsigned int QUIRK_PROFILES = 16;
+
+// Accepts a profile name (modern, cosmac, schip, xochip) or a number below QUIRK_PROFILES
+bool ParseQuirks(char const* text, uint8_t& quirks);
+
+// False unless text is a decimal number no larger than max, for the numeric options of the frontends and tools
+bool ParseNumber(char const* text, uint64_t max, uint64_t& value);
+
+// What Chip8::LoadROM() made of a file, memory is only written once the file is known to fit
+enum class RomStatus : uint8_t {
+    Loaded,
+    Unreadable, // missing, not a regular file, or a read error
+    Empty,
+    TooLarge    // more than MAX_ROM_SIZE bytes
+};
+
+// "cannot be read", "is empty", ... to follow the file name in a message
+char const* RomStatusText(RomStatus status);
+
+// Content hash that identifies a ROM whatever its file is called, the same bytes always give the same hash
+uint64_t HashROM(uint8_t const* data, size_t size);
+
+struct RunResult {
+    uint32_t cycles;   // executed or skipped as idle before stopping
+    StopReason reason;
+};
+
+// Everything that makes up the emulated machine, trivially copyable so a whole machine is one memcpy
+struct alignas(64) Chip8State {
+    // Touched by nearly every instruction, kept together in the first cache line
+    uint8_t registers[16]{};
+    uint16_t index{};
+    uint16_t pc{};
+    uint8_t sp{};
+    uint8_t delayTimer{};
+    uint8_t soundTimer{};
+
+    // Emulated clock: instructionsPerSecond cycles make one second, the timers tick TIMER_HZ times in it
+    uint32_t timerPhase{}; // cycles since the last timer tick, times TIMER_HZ
+    uint32_t instructionsPerSecond{600};
+    uint16_t stack[16]{};
+
+    uint64_t elapsedCycles{};
+    uint64_t rngState{}; // PCG32 state behind Cxkk, set with Chip8::Seed()
+    uint8_t keypad[16]{};
+    uint64_t video[VIDEO_HEIGHT]{};
+    uint8_t memory[4096]{};
+};
+
+static_assert(std::is_trivially_copyable<Chip8State>::value, "Chip8State must stay memcpy-able");
+static_assert(offsetof(Chip8State, stack) + sizeof(Chip8State::stack) <= 64, "hot fields must fit in one cache line");
+
+// Bytes of Chip8State that hold data, the compiler may place Chip8's own members in the tail padding after memory
+const size_t CHIP8_STATE_BYTES = offsetof(Chip8State, memory) + sizeof(Chip8State::memory);
+static_assert(sizeof(Chip8State) - CHIP8_STATE_BYTES < 64, "memory must stay the last field");
+
+// Save state layout: this header, then the first CHIP8_STATE_BYTES of Chip8State exactly as they are in memory
+struct SaveStateHeader {
+    char magic[4];       // "C8SS"
+    uint16_t version;    // SAVE_STATE_VERSION, also rejects states written with the other byte order
+    uint8_t quirks;      // profile the machine was running with
+    uint8_t reserved;
+    uint32_t stateBytes; // CHIP8_STATE_BYTES of the writer
+};
+
+// Bump whenever a field of Chip8State is added, removed or moved
+const uint16_t SAVE_STATE_VERSION = 1;
+const size_t SAVE_STATE_SIZE = sizeof(SaveStateHeader) + CHIP8_STATE_BYTES;
+
+// Interpreter around a Chip8State, everything it adds on top is derived from the state or is host-side configuration
+//
+// sizeof(Chip8) is 15808 bytes on x86-64: the 4480-byte state, 8 KB of decodeCache, 2 KB of blockLength and the
+// 512-byte watched and breakpoints bitmaps
+class Chip8 : public Chip8State {
+    public:
+        // Decoded instruction for every even address in memory, filled lazily by Cycle()
+        Instruction decodeCache[4096 / 2];
+
+        // Number of instructions in the basic block starting at each even address, 0 = not built yet
+        uint8_t blockLength[4096 / 2]{};
+        Engine engine{Engine::Interpreter};
+
+        // Bumped whenever a write changes memory marked in watched
+        uint32_t codeWrites{};
+
+        // One bit per address a translator (the JIT) compiled code from
+        uint8_t watched[4096 / 8]{};
+
+        // Run() fast-forwards idle loops while this is set, skippedCycles counts what it did not execute
+        bool skipIdle{true};
+        uint64_t skippedCycles{};
+
+        // One bit per address, Run() stops before executing a marked instruction
+        uint8_t breakpoints[4096 / 8]{};
+        uint16_t breakpointCount{};
+
+        Chip8();
+        RomStatus LoadROM(char const* filename);
+
+        // HashROM() and size of what LoadROM() last loaded, the key for quirk profiles, metadata and translations
+        uint64_t romHash{};
+        uint16_t romSize{};
+
+        // Replace the whole machine state, decoded code is only dropped where memory actually differs
+        void SetState(Chip8State const& state);
+        Chip8State const& State() const;
+
+        // Serialize to exactly SAVE_STATE_SIZE bytes, LoadState() returns false for a foreign header or size and for
+        // a payload with a zero clock or sp, pc, index or a return address out of range
+        void SaveState(void* buffer) const;
+        bool LoadState(void const* buffer, size_t size);
+        void RestoreState(uint8_t const* bytes); // CHIP8_STATE_BYTES laid out like Chip8State, need not be aligned
+
+        // Same seed, same ROM and same input always give the same run, a new Chip8 starts from seed 0
+        void Seed(uint64_t seed);
+        uint8_t RandomByte();
+
+        void OP_00E0(Instruction ins); // Clear the display
+        void OP_00EE(Instruction ins); // Return from a subroutine
+        void OP_1nnn(Instruction ins); // Jump to location nnn
+        void OP_2nnn(Instruction ins); // Call subroutine at nnn
+        void OP_3xkk(Instruction ins); // Skip next instruction if Vx = kk
+        void OP_4xkk(Instruction ins); // Skip next instruction if Vx != kk
+        void OP_5xy0(Instruction ins); // Skip next instruction if Vx = Vy
+        void OP_6xkk(Instruction ins); // Set Vx = kk
+        void OP_7xkk(Instruction ins); // Set Vx = Vx + kk
+        void OP_8xy0(Instruction ins); // Set Vx = Vy
+        void OP_8xy1(Instruction ins); // Set Vx = Vx | Vy
+        void OP_8xy2(Instruction ins); // Set Vx = Vx & Vy
+        void OP_8xy3(Instruction ins); // Set Vx = Vx ^ Vy
+        void OP_8xy4(Instruction ins); // Set Vx = Vx + Vy, set VF = carry
+        void OP_8xy5(Instruction ins); // Set Vx = Vx - Vy, set VF = NOT borrow
+        template <uint8_t Quirks> void OP_8xy6(Instruction ins); // Set Vx = Vx >> 1
+        void OP_8xy7(Instruction ins); // Set Vx = Vy - Vx, set VF = NOT borrow
+        template <uint8_t Quirks> void OP_8xyE(Instruction ins); // Set Vx = Vx << 1
+        void OP_9xy0(Instruction ins); // Skip next instruction if Vx != Vy
+        void OP_Annn(Instruction ins); // Set index = nnn
+        template <uint8_t Quirks> void OP_Bnnn(Instruction ins); // Jump to location nnn + V0
+        void OP_Cxkk(Instruction ins); // Set Vx = random byte AND kk
+        template <uint8_t Quirks> void OP_Dxyn(Instruction ins); // Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision
+        void OP_Ex9E(Instruction ins); // Skip next instruction if key with the value of Vx is pressed
+        void OP_ExA1(Instruction ins); // Skip next instruction if key with the value of Vx is not pressed
+        void OP_Fx07(Instruction ins); // Set Vx = delay timer value
+        void OP_Fx0A(Instruction ins); // Wait for a key press, store the value of the key in Vx
+        void OP_Fx15(Instruction ins); // Set delay timer = Vx
+        void OP_Fx18(Instruction ins); // Set sound timer = Vx
+        void OP_Fx1E(Instruction ins); // Set index = index + Vx
+        void OP_Fx29(Instruction ins); // Set index = location of sprite for digit Vx
+        void OP_Fx33(Instruction ins); // Store BCD representation of Vx in memory locations I, I+1, and I+2
+        template <uint8_t Quirks> void OP_Fx55(Instruction ins); // Store registers V0 through Vx in memory starting at location I
+        template <uint8_t Quirks> void OP_Fx65(Instruction ins); // Read registers V0 through Vx from memory starting at location I
+
+        // Nested dispatch used by CycleNested(), shared by every instance and filled once by BuildOpTable()
+        typedef void (Chip8::*Chip8Func)(Instruction);
+        static Chip8Func table[0xF + 1];
+        static Chip8Func table0[0xE + 1];
+        static Chip8Func table8[0xE + 1];
+        static Chip8Func tableE[0xE + 1];
+        static Chip8Func tableF[0x65 + 1];
+
+        void Table0(Instruction ins);
+        void Table8(Instruction ins);
+        void TableE(Instruction ins);
+        void TableF(Instruction ins);
+        void OP_NULL(Instruction ins);
+
+        // Flat dispatch: opcode -> handler id -> handler, shared by every instance, one handler table per quirk profile
+        static uint8_t opTable[0x10000];
+        static Chip8Func opHandlers[QUIRK_PROFILES][OP_ID_COUNT];
+        typedef uint8_t (Chip8::*RunBlockFunc)(uint16_t, uint8_t);
+        static RunBlockFunc blockRunners[QUIRK_PROFILES];
+        static uint8_t DecodeOp(uint16_t opcode);
+        static bool BuildOpTable();
+        static Instruction Decode(uint16_t opcode);
+
+        // Quirk profile in use, handlers and runBlock are the ones compiled for it, so no handler tests a quirk at runtime
+        uint8_t quirks{};
+        Chip8Func const* handlers{};
+        RunBlockFunc runBlock{};
+        void SetQuirks(uint8_t profile);
+
+        // Must be called after anything other than the OP_* handlers writes to memory
+        void InvalidateDecodeCache(uint16_t address, uint16_t length);
+
+        void Cycle();
+        void CycleNested();
+
+        // Execute up to the given number of instructions with the selected engine, see StopFlags for early stops
+        RunResult Run(uint32_t cycles, uint8_t stops = 0);
+
+        void SetBreakpoint(uint16_t address, bool enabled);
+        bool IsBreakpoint(uint16_t address) const;
+        bool WaitingForKey();
+        uint32_t CyclesToNextTick() const;
+
+        static bool EndsBlock(uint8_t op);
+        uint8_t BlockLength(uint16_t address);
+        template <uint8_t Quirks> uint8_t RunBlock(uint16_t address, uint8_t count);
+        void TickTimers(unsigned int cycles);
+        uint64_t TicksAfter(uint64_t cycles) const;
+        uint32_t SkipIdle(uint32_t cycles);
+
+        // Expand the framebuffer to one RGBA pixel per uint32_t, only needed when a frame is presented
+        void Render(uint32_t* pixels) const;
+};
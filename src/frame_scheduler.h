@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <thread>
+
+/*
+Paces the main loop at the display refresh rate
+
+Each frame runs a fixed number of instructions, presents once and then waits for the next refresh, so the
+emulation speed no longer depends on how fast the renderer can present. Frame time is the work done inside
+one frame (input, instructions, render, present); IPS is measured against wall-clock time.
+
+Waiting can
+- Sleep: cheapest, but wakes up as late as the OS timer allows
+- Spin: wakes up on time but keeps a core busy for the whole frame
+- Hybrid: sleep until shortly before the refresh and spin for the rest, the margin grows to cover the
+  oversleep the OS actually shows, capped at a few milliseconds
+
+Jitter is how late the loop woke up compared to the refresh it waited for.
+*/
+
+enum class Pacing : uint8_t {
+	Sleep,
+	Hybrid,
+	Spin
+};
+
+class FrameScheduler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	FrameScheduler(double framesPerSecond, Pacing pacing = Pacing::Hybrid)
+		: framePeriod(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond))),
+		  pacing(pacing)
+	{
+		nextFrame = Clock::now();
+		reportStart = nextFrame;
+	}
+
+	void BeginFrame()
+	{
+		frameStart = Clock::now();
+	}
+
+	void EndFrame(uint64_t instructions)
+	{
+		Clock::duration frameTime = Clock::now() - frameStart;
+
+		++frames;
+		executed += instructions;
+		totalFrameTime += frameTime;
+		maxFrameTime = std::max(maxFrameTime, frameTime);
+	}
+
+	// Wait for the next refresh, or start right away when the last frame overran it
+	void WaitForNextFrame()
+	{
+		nextFrame += framePeriod;
+
+		Clock::time_point now = Clock::now();
+
+		if (nextFrame < now)
+		{
+			// Too far behind to catch up, drop the missed refreshes instead of running frames back to back
+			nextFrame = now;
+			return;
+		}
+
+		if (pacing == Pacing::Sleep)
+		{
+			std::this_thread::sleep_until(nextFrame);
+		}
+		else if (pacing == Pacing::Hybrid)
+		{
+			Clock::time_point wake = nextFrame - spinMargin;
+
+			if (wake > now)
+			{
+				std::this_thread::sleep_until(wake);
+
+				// Leave room for the worst oversleep seen lately, let the margin shrink back slowly
+				Clock::duration oversleep = Clock::now() - wake;
+				Clock::duration wanted = std::max<Clock::duration>(std::chrono::microseconds(200), oversleep + oversleep / 4);
+				spinMargin = std::max(spinMargin - spinMargin / 64, wanted);
+				spinMargin = std::min<Clock::duration>(spinMargin, std::chrono::milliseconds(4));
+			}
+		}
+
+		while (Clock::now() < nextFrame)
+		{
+		}
+
+		Clock::duration late = Clock::now() - nextFrame;
+
+		++waits;
+		totalJitter += late;
+		maxJitter = std::max(maxJitter, late);
+	}
+
+	bool ReportDue() const
+	{
+		return Clock::now() - reportStart >= std::chrono::seconds(1);
+	}
+
+	// Print IPS and frame time since the last report, then start a new measurement
+	void Report(std::ostream& out)
+	{
+		Clock::time_point now = Clock::now();
+		double seconds = std::chrono::duration<double>(now - reportStart).count();
+
+		out << static_cast<uint64_t>(executed / seconds) << " IPS, "
+			<< frames / seconds << " FPS, frame time "
+			<< Milliseconds(totalFrameTime) / std::max<uint64_t>(frames, 1) << " ms avg, "
+			<< Milliseconds(maxFrameTime) << " ms max, jitter "
+			<< Milliseconds(totalJitter) / std::max<uint64_t>(waits, 1) << " ms avg, "
+			<< Milliseconds(maxJitter) << " ms max\n";
+
+		reportStart = now;
+		frames = 0;
+		executed = 0;
+		totalFrameTime = Clock::duration::zero();
+		maxFrameTime = Clock::duration::zero();
+		waits = 0;
+		totalJitter = Clock::duration::zero();
+		maxJitter = Clock::duration::zero();
+	}
+
+private:
+	static double Milliseconds(Clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+
+	Clock::duration framePeriod;
+	Pacing pacing;
+	Clock::duration spinMargin{std::chrono::microseconds(500)};
+	Clock::time_point nextFrame;
+	Clock::time_point frameStart;
+	Clock::time_point reportStart;
+
+	uint64_t frames{};
+	uint64_t executed{};
+	Clock::duration totalFrameTime{};
+	Clock::duration maxFrameTime{};
+
+	uint64_t waits{};
+	Clock::duration totalJitter{};
+	Clock::duration maxJitter{};
+};
@@ -0,0 +1,619 @@
+#include "jit_x64.h"
+
+#if CHIP8_JIT_AVAILABLE
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+    // Host registers handed out to V registers, in allocation order
+    const uint8_t V_HOST_REGS[] = {
+        x64::RSI, x64::RDI, x64::RBP, x64::R8, x64::R9, x64::R10, x64::R11, x64::R14, x64::R15
+    };
+    const unsigned int V_HOST_REG_COUNT = sizeof(V_HOST_REGS);
+    const uint8_t NO_HOST_REG = 0xFF;
+
+    int32_t OffsetOf(Chip8 const& chip8, void const* field) {
+        return static_cast<int32_t>(static_cast<char const*>(field) - reinterpret_cast<char const*>(&chip8));
+    }
+
+    unsigned int PopCount(uint16_t mask) {
+        unsigned int count = 0;
+
+        for (; mask; mask &= mask - 1) {
+            ++count;
+        }
+
+        return count;
+    }
+}
+
+Jit::Jit(Chip8& chip8) : chip8(chip8) {
+    void* memory = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (memory != MAP_FAILED) {
+        emit.code = static_cast<uint8_t*>(memory);
+        emit.capacity = CODE_SIZE;
+    }
+
+    offsets.registers = OffsetOf(chip8, chip8.registers);
+    offsets.index = OffsetOf(chip8, &chip8.index);
+    offsets.pc = OffsetOf(chip8, &chip8.pc);
+    offsets.stack = OffsetOf(chip8, chip8.stack);
+    offsets.sp = OffsetOf(chip8, &chip8.sp);
+
+    char perfMapName[64];
+    snprintf(perfMapName, sizeof(perfMapName), "/tmp/perf-%d.map", static_cast<int>(getpid()));
+    perfMap = fopen(perfMapName, "a");
+
+    if (emit.code) {
+        EmitTrampoline();
+    }
+
+    // Nothing is translated yet, marks a previous Jit left behind would only cost needless checks
+    memset(chip8.watched, 0, sizeof(chip8.watched));
+    seenCodeWrites = chip8.codeWrites;
+    quirks = chip8.quirks;
+}
+
+Jit::~Jit() {
+    if (emit.code) {
+        munmap(emit.code, emit.capacity);
+    }
+
+    memset(chip8.watched, 0, sizeof(chip8.watched));
+
+    if (perfMap) {
+        fclose(perfMap);
+    }
+}
+
+void Jit::EmitTrampoline() {
+    enter = reinterpret_cast<EntryFunc>(emit.Here());
+
+    // push rbx, rbp, r12-r15
+    emit.Byte(0x53);
+    emit.Byte(0x55);
+    emit.Byte(0x41); emit.Byte(0x54);
+    emit.Byte(0x41); emit.Byte(0x55);
+    emit.Byte(0x41); emit.Byte(0x56);
+    emit.Byte(0x41); emit.Byte(0x57);
+
+    // rbx = chip8, r13d = budget, r12d = 0, then jump to the block in rdx
+    emit.Byte(0x48); emit.Byte(0x89); emit.Byte(0xFB);
+    emit.Mov32(x64::R13, x64::RSI);
+    emit.Byte(0x45); emit.Byte(0x31); emit.Byte(0xE4);
+    emit.Byte(0xFF); emit.Byte(0xE2);
+
+    epilogue = emit.Here();
+
+    // return r12d after restoring the callee-saved registers
+    emit.Mov32(x64::RAX, x64::R12);
+    emit.Byte(0x41); emit.Byte(0x5F);
+    emit.Byte(0x41); emit.Byte(0x5E);
+    emit.Byte(0x41); emit.Byte(0x5D);
+    emit.Byte(0x41); emit.Byte(0x5C);
+    emit.Byte(0x5D);
+    emit.Byte(0x5B);
+    emit.Byte(0xC3);
+
+    codeStart = emit.used;
+
+    if (perfMap) {
+        fprintf(perfMap, "%lx %lx chip8_jit_trampoline\n",
+            reinterpret_cast<unsigned long>(emit.code), static_cast<unsigned long>(codeStart));
+        fflush(perfMap);
+    }
+}
+
+void Jit::Flush() {
+    emit.used = codeStart;
+    memset(entries, 0, sizeof(entries));
+    memset(hits, 0, sizeof(hits));
+    pendingExits.clear();
+    translations.clear();
+    memset(chip8.watched, 0, sizeof(chip8.watched));
+    seenCodeWrites = chip8.codeWrites;
+    quirks = chip8.quirks;
+}
+
+bool Jit::SourceChanged() const {
+    for (size_t i = 0; i < translations.size(); ++i) {
+        Translation const& t = translations[i];
+
+        if (memcmp(&chip8.memory[t.address], &source[t.address], t.length) != 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Jit::IsNative(uint8_t op) {
+    switch (op) {
+        case OP_ID_NULL:
+        case OP_ID_00EE:
+        case OP_ID_1nnn:
+        case OP_ID_2nnn:
+        case OP_ID_3xkk:
+        case OP_ID_4xkk:
+        case OP_ID_5xy0:
+        case OP_ID_6xkk:
+        case OP_ID_7xkk:
+        case OP_ID_8xy0:
+        case OP_ID_8xy1:
+        case OP_ID_8xy2:
+        case OP_ID_8xy3:
+        case OP_ID_8xy4:
+        case OP_ID_8xy5:
+        case OP_ID_8xy6:
+        case OP_ID_8xy7:
+        case OP_ID_8xyE:
+        case OP_ID_9xy0:
+        case OP_ID_Annn:
+        case OP_ID_Bnnn:
+        case OP_ID_Fx1E:
+        case OP_ID_Fx29:
+            return true;
+    }
+
+    return false;
+    /*
+    - everything else touches the screen, keypad, timers, RNG or memory and runs through Chip8::Cycle()
+    - since Fx33/Fx55 are never native, self-modifying writes always happen outside translated code
+    */
+}
+
+uint16_t Jit::RegistersUsed(Instruction ins, uint8_t quirks) {
+    uint16_t x = 1u << ins.x;
+    uint16_t y = 1u << ins.y;
+    uint16_t f = 1u << 0xF;
+
+    switch (ins.op) {
+        case OP_ID_3xkk:
+        case OP_ID_4xkk:
+        case OP_ID_6xkk:
+        case OP_ID_7xkk:
+        case OP_ID_Fx1E:
+        case OP_ID_Fx29:
+            return x;
+        case OP_ID_5xy0:
+        case OP_ID_9xy0:
+        case OP_ID_8xy0:
+        case OP_ID_8xy1:
+        case OP_ID_8xy2:
+        case OP_ID_8xy3:
+            return x | y;
+        case OP_ID_8xy4:
+        case OP_ID_8xy5:
+        case OP_ID_8xy7:
+            return x | y | f;
+        case OP_ID_8xy6:
+        case OP_ID_8xyE:
+            return (quirks & QUIRK_SHIFT_VY) ? x | y | f : x | f;
+        case OP_ID_Bnnn:
+            return (quirks & QUIRK_JUMP_VX) ? x : 1u;
+    }
+
+    return 0;
+}
+
+uint16_t Jit::RegistersWritten(Instruction ins) {
+    uint16_t x = 1u << ins.x;
+    uint16_t f = 1u << 0xF;
+
+    switch (ins.op) {
+        case OP_ID_6xkk:
+        case OP_ID_7xkk:
+        case OP_ID_8xy0:
+        case OP_ID_8xy1:
+        case OP_ID_8xy2:
+        case OP_ID_8xy3:
+            return x;
+        case OP_ID_8xy4:
+        case OP_ID_8xy5:
+        case OP_ID_8xy6:
+        case OP_ID_8xy7:
+        case OP_ID_8xyE:
+            return x | f;
+    }
+
+    return 0;
+}
+
+void Jit::EmitStores(uint8_t const* hostOf, uint16_t dirty, bool writesI) {
+    for (unsigned int v = 0; v < 16; ++v) {
+        if (dirty & (1u << v)) {
+            emit.StoreByte(offsets.registers + v, hostOf[v]);
+        }
+    }
+
+    if (writesI) {
+        emit.StoreWord(offsets.index, x64::RCX);
+    }
+}
+
+void Jit::EmitExit(uint16_t target, uint8_t const* hostOf, uint16_t dirty, bool writesI) {
+    EmitStores(hostOf, dirty, writesI);
+    emit.StoreWordImm(offsets.pc, target);
+
+    // Chain straight into the target block when it exists, otherwise return and patch this jump later
+    if ((target & 0xF001u) == 0 && entries[target >> 1u]) {
+        emit.Jmp(entries[target >> 1u]);
+        return;
+    }
+
+    uint8_t* site = emit.Jmp(epilogue);
+
+    if ((target & 0xF001u) == 0) {
+        PendingExit exit = { target, site };
+        pendingExits.push_back(exit);
+    }
+}
+
+void Jit::EmitDynamicExit(uint8_t const* hostOf, uint16_t dirty, bool writesI) {
+    EmitStores(hostOf, dirty, writesI);
+
+    // movzx eax, word [pc]; test eax, 0xF001; jnz epilogue
+    emit.LoadWord(x64::RAX, offsets.pc);
+    emit.Byte(0xA9); emit.Dword(0xF001u);
+    emit.Jcc(x64::COND_NE, epilogue);
+
+    // rdx = entries[pc >> 1]; if it is null return, otherwise jump to it
+    emit.Byte(0xD1); emit.Byte(0xE8);
+    emit.Byte(0x48); emit.Byte(0xBA); emit.Qword(reinterpret_cast<uint64_t>(entries));
+    emit.Byte(0x48); emit.Byte(0x8B); emit.Byte(0x14); emit.Byte(0xC2);
+    emit.Byte(0x48); emit.Byte(0x85); emit.Byte(0xD2);
+    emit.Jcc(x64::COND_E, epilogue);
+    emit.Byte(0xFF); emit.Byte(0xE2);
+}
+
+bool Jit::Compile(uint16_t address) {
+    if (emit.Free() < MAX_BLOCK_CODE) {
+        Flush();
+    }
+
+    // Pick the instructions and give every V register they touch a host register
+    uint8_t hostOf[16];
+    memset(hostOf, NO_HOST_REG, sizeof(hostOf));
+
+    Instruction block[MAX_BLOCK_LENGTH];
+    unsigned int count = 0;
+    uint16_t used = 0;
+    uint16_t dirty = 0;
+    bool usesI = false;
+
+    for (unsigned int entry = address >> 1u; count < MAX_BLOCK_LENGTH && entry < 4096 / 2; ++entry) {
+        Instruction& ins = chip8.decodeCache[entry];
+
+        if (ins.op == OP_ID_UNDECODED) {
+            ins = Chip8::Decode((chip8.memory[2 * entry] << 8u) | chip8.memory[2 * entry + 1]);
+        }
+
+        if (!IsNative(ins.op) || PopCount(used | RegistersUsed(ins, quirks)) > V_HOST_REG_COUNT) {
+            break;
+        }
+
+        used |= RegistersUsed(ins, quirks);
+        dirty |= RegistersWritten(ins);
+        usesI |= ins.op == OP_ID_Annn || ins.op == OP_ID_Fx1E || ins.op == OP_ID_Fx29;
+        block[count++] = ins;
+
+        if (Chip8::EndsBlock(ins.op)) {
+            break;
+        }
+    }
+
+    if (count == 0) {
+        return false;
+    }
+
+    unsigned int nextHost = 0;
+
+    for (unsigned int v = 0; v < 16; ++v) {
+        if (used & (1u << v)) {
+            hostOf[v] = V_HOST_REGS[nextHost++];
+        }
+    }
+
+    uint8_t* entry = emit.Here();
+
+    // Budget check: r12d + count must not go past r13d
+    emit.Mov32(x64::RAX, x64::R12);
+    emit.AddImm32(x64::RAX, count);
+    emit.Cmp32(x64::RAX, x64::R13);
+    emit.Jcc(x64::COND_A, epilogue);
+    emit.Mov32(x64::R12, x64::RAX);
+
+    for (unsigned int v = 0; v < 16; ++v) {
+        if (used & (1u << v)) {
+            emit.LoadByte(hostOf[v], offsets.registers + v);
+        }
+    }
+
+    if (usesI) {
+        emit.LoadWord(x64::RCX, offsets.index);
+    }
+
+    bool exited = false;
+
+    for (unsigned int i = 0; i < count; ++i) {
+        Instruction ins = block[i];
+        uint16_t insAddress = address + 2 * i;
+        uint8_t x = hostOf[ins.x];
+        uint8_t y = hostOf[ins.y];
+        uint8_t f = hostOf[0xF];
+        uint8_t shifted = (quirks & QUIRK_SHIFT_VY) ? y : x;
+        uint8_t* skip = nullptr;
+
+        switch (ins.op) {
+            case OP_ID_NULL:
+                break;
+
+            case OP_ID_6xkk: emit.MovByteImm(x, ins.kk); break;
+            case OP_ID_7xkk: emit.ByteRegImm(x64::GROUP_ADD, x, ins.kk); break;
+            case OP_ID_8xy0: emit.ByteRegReg(x64::BYTE_MOV, x, y); break;
+            case OP_ID_8xy1: emit.ByteRegReg(x64::BYTE_OR, x, y); break;
+            case OP_ID_8xy2: emit.ByteRegReg(x64::BYTE_AND, x, y); break;
+            case OP_ID_8xy3: emit.ByteRegReg(x64::BYTE_XOR, x, y); break;
+
+            // The flag is written before Vx, exactly like the handlers, so x == F or y == F behave the same
+            case OP_ID_8xy4:
+                emit.ByteRegReg(x64::BYTE_MOV, x64::RAX, x);
+                emit.ByteRegReg(x64::BYTE_ADD, x64::RAX, y);
+                emit.Setcc(x64::COND_C, x64::RDX);
+                emit.ByteRegReg(x64::BYTE_MOV, f, x64::RDX);
+                emit.ByteRegReg(x64::BYTE_MOV, x, x64::RAX);
+                break;
+            case OP_ID_8xy5:
+                emit.ByteRegReg(x64::BYTE_CMP, x, y);
+                emit.Setcc(x64::COND_A, x64::RDX);
+                emit.ByteRegReg(x64::BYTE_MOV, f, x64::RDX);
+                emit.ByteRegReg(x64::BYTE_SUB, x, y);
+                break;
+            // With QUIRK_SHIFT_VY the source is Vy, read again after the flag is written just like the handlers
+            case OP_ID_8xy6:
+                emit.ByteRegReg(x64::BYTE_MOV, x64::RDX, shifted);
+                emit.ByteRegImm(x64::GROUP_AND, x64::RDX, 1);
+                emit.ByteRegReg(x64::BYTE_MOV, f, x64::RDX);
+                if (shifted != x) {
+                    emit.ByteRegReg(x64::BYTE_MOV, x, shifted);
+                }
+                emit.ShiftByte(x64::GROUP_SHR, x, 1);
+                break;
+            case OP_ID_8xy7:
+                emit.ByteRegReg(x64::BYTE_CMP, y, x);
+                emit.Setcc(x64::COND_A, x64::RDX);
+                emit.ByteRegReg(x64::BYTE_MOV, f, x64::RDX);
+                emit.ByteRegReg(x64::BYTE_MOV, x64::RAX, y);
+                emit.ByteRegReg(x64::BYTE_SUB, x64::RAX, x);
+                emit.ByteRegReg(x64::BYTE_MOV, x, x64::RAX);
+                break;
+            case OP_ID_8xyE:
+                emit.ByteRegReg(x64::BYTE_MOV, x64::RDX, shifted);
+                emit.ShiftByte(x64::GROUP_SHR, x64::RDX, 7);
+                emit.ByteRegReg(x64::BYTE_MOV, f, x64::RDX);
+                if (shifted != x) {
+                    emit.ByteRegReg(x64::BYTE_MOV, x, shifted);
+                }
+                emit.ShiftByte(x64::GROUP_SHL, x, 1);
+                break;
+
+            case OP_ID_Annn:
+                emit.MovImm32(x64::RCX, ins.nnn());
+                break;
+            case OP_ID_Fx1E:
+                emit.MovzxByte(x64::RAX, x);
+                emit.Add32(x64::RCX, x64::RAX);
+                break;
+            case OP_ID_Fx29:
+                // lea ecx, [rax + rax * 4 + FONT_START_ADDRESS]
+                emit.MovzxByte(x64::RAX, x);
+                emit.Byte(0x8D); emit.Byte(0x4C); emit.Byte(0x80); emit.Byte(FONT_START_ADDRESS);
+                break;
+
+            // Skips: fall through to the "skip" exit, jump over it to the "no skip" exit
+            case OP_ID_3xkk:
+                emit.ByteRegImm(x64::GROUP_CMP, x, ins.kk);
+                skip = emit.Jcc(x64::COND_NE, emit.Here());
+                break;
+            case OP_ID_4xkk:
+                emit.ByteRegImm(x64::GROUP_CMP, x, ins.kk);
+                skip = emit.Jcc(x64::COND_E, emit.Here());
+                break;
+            case OP_ID_5xy0:
+                emit.ByteRegReg(x64::BYTE_CMP, x, y);
+                skip = emit.Jcc(x64::COND_NE, emit.Here());
+                break;
+            case OP_ID_9xy0:
+                emit.ByteRegReg(x64::BYTE_CMP, x, y);
+                skip = emit.Jcc(x64::COND_E, emit.Here());
+                break;
+
+            case OP_ID_1nnn:
+                EmitExit(ins.nnn(), hostOf, dirty, usesI);
+                exited = true;
+                break;
+            case OP_ID_2nnn:
+                // stack[sp] = pc; ++sp
+                emit.LoadByte(x64::RAX, offsets.sp);
+                emit.Byte(0x66); emit.Byte(0xC7); emit.Byte(0x84); emit.Byte(0x43);
+                emit.Dword(offsets.stack);
+                emit.Word(insAddress + 2);
+                emit.IncByte(offsets.sp);
+                EmitExit(ins.nnn(), hostOf, dirty, usesI);
+                exited = true;
+                break;
+            case OP_ID_00EE:
+                // --sp; pc = stack[sp]
+                emit.DecByte(offsets.sp);
+                emit.LoadByte(x64::RAX, offsets.sp);
+                emit.Byte(0x0F); emit.Byte(0xB7); emit.Byte(0x84); emit.Byte(0x43);
+                emit.Dword(offsets.stack);
+                emit.StoreWord(offsets.pc, x64::RAX);
+                EmitDynamicExit(hostOf, dirty, usesI);
+                exited = true;
+                break;
+            case OP_ID_Bnnn:
+                // pc = V0 + nnn, or Vx + nnn with QUIRK_JUMP_VX
+                emit.MovzxByte(x64::RAX, (quirks & QUIRK_JUMP_VX) ? x : hostOf[0]);
+                emit.AddImm32(x64::RAX, ins.nnn());
+                emit.StoreWord(offsets.pc, x64::RAX);
+                EmitDynamicExit(hostOf, dirty, usesI);
+                exited = true;
+                break;
+        }
+
+        if (skip) {
+            EmitExit(insAddress + 4, hostOf, dirty, usesI);
+            Emitter::Patch(skip, emit.Here());
+            EmitExit(insAddress + 2, hostOf, dirty, usesI);
+            exited = true;
+        }
+    }
+
+    // The block was cut short before a non-native instruction
+    if (!exited) {
+        EmitExit(address + 2 * count, hostOf, dirty, usesI);
+    }
+
+    entries[address >> 1u] = entry;
+    ++blocksCompiled;
+
+    Translation translation = { address, static_cast<uint16_t>(2 * count) };
+    translations.push_back(translation);
+    memcpy(&source[address], &chip8.memory[address], translation.length);
+
+    // Stores into these bytes bump chip8.codeWrites from now on
+    for (unsigned int byte = address; byte < address + translation.length; ++byte) {
+        chip8.watched[byte / 8u] |= 1u << (byte % 8u);
+    }
+
+    // Exits compiled earlier can now jump straight here
+    for (size_t i = 0; i < pendingExits.size();) {
+        if (pendingExits[i].target == address) {
+            Emitter::Patch(pendingExits[i].site, entry);
+            pendingExits[i] = pendingExits.back();
+            pendingExits.pop_back();
+        } else {
+            ++i;
+        }
+    }
+
+    if (perfMap) {
+        fprintf(perfMap, "%lx %lx chip8_jit_%03x\n",
+            reinterpret_cast<unsigned long>(entry), static_cast<unsigned long>(emit.Here() - entry), address);
+        fflush(perfMap);
+    }
+
+    return true;
+}
+
+uint8_t* Jit::Lookup(uint16_t address) {
+    unsigned int entry = address >> 1u;
+
+    if (entries[entry] || hits[entry] == NO_NATIVE_CODE) {
+        return entries[entry];
+    }
+
+    if (++hits[entry] < HOT_THRESHOLD) {
+        return nullptr;
+    }
+
+    if (!Compile(address)) {
+        hits[entry] = NO_NATIVE_CODE;
+    }
+
+    return entries[entry];
+}
+
+RunResult Jit::Run(uint32_t cycles, uint8_t stops) {
+    // Breakpoints are checked on every instruction, which only the interpreter does
+    if (!emit.code || chip8.breakpointCount > 0) {
+        RunResult result = chip8.Run(cycles, stops);
+        interpretedCycles += result.cycles;
+        return result;
+    }
+
+    RunResult result = {0, StopReason::Budget};
+
+    if (stops & STOP_ON_FRAME) {
+        uint32_t untilTick = chip8.CyclesToNextTick();
+
+        if (untilTick <= cycles) {
+            cycles = untilTick;
+            result.reason = StopReason::Frame;
+        }
+    }
+
+    while (result.cycles < cycles) {
+        if (chip8.quirks != quirks) {
+            Flush();
+        }
+
+        // Self-modifying code: once any translated block changed, nothing translated so far can be trusted
+        if (chip8.codeWrites != seenCodeWrites) {
+            if (SourceChanged()) {
+                Flush();
+            }
+
+            seenCodeWrites = chip8.codeWrites;
+        }
+
+        // Fx0A is never translated, so translated code always comes back here before one
+        if ((stops & STOP_ON_KEY_WAIT) && chip8.WaitingForKey()) {
+            result.reason = StopReason::KeyWait;
+            return result;
+        }
+
+        uint32_t skipped = chip8.skipIdle ? chip8.SkipIdle(cycles - result.cycles) : 0;
+
+        if (skipped > 0) {
+            result.cycles += skipped;
+            continue;
+        }
+
+        if ((chip8.pc & 0xF001u) == 0) {
+            uint8_t* code = Lookup(chip8.pc);
+
+            if (code) {
+                uint32_t executed = enter(&chip8, cycles - result.cycles, code);
+
+                if (executed > 0) {
+                    // Translated code never reads the timers, so they can be caught up afterwards
+                    chip8.TickTimers(executed);
+                    nativeCycles += executed;
+                    result.cycles += executed;
+                    continue;
+                }
+            }
+        }
+
+        chip8.Cycle();
+        ++interpretedCycles;
+        ++result.cycles;
+    }
+
+    return result;
+}
+
+#else
+
+Jit::Jit(Chip8& chip8) : chip8(chip8) {}
+
+Jit::~Jit() {}
+
+void Jit::Flush() {}
+
+RunResult Jit::Run(uint32_t cycles, uint8_t stops) {
+    // No translator for this host, the basic-block engine is the next best thing, the caller's choice stays as it was
+    Engine engine = chip8.engine;
+    chip8.engine = Engine::BasicBlock;
+
+    RunResult result = chip8.Run(cycles, stops);
+    chip8.engine = engine;
+    interpretedCycles += result.cycles;
+    return result;
+}
+
+#endif
@@ -0,0 +1,246 @@
+#pragma once
+
+#include "chip8.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define CHIP8_JIT_AVAILABLE 1
+#else
+#define CHIP8_JIT_AVAILABLE 0
+#endif
+
+/*
+x86-64 dynamic recompiler for the Chip8 core
+
+- hot blocks (same boundaries as the basic-block engine) are translated to native code
+- inside a block every V register it touches lives in a host register, I lives in ecx, and pc is a constant
+- blocks end with exits that store the dirty registers and pc, then jump straight into the next translated block
+- anything that is not translated (Dxyn, Fx0A, timers, keypad, stores, ...) falls back to Chip8::Cycle()
+- translated bytes are marked in Chip8::watched, writes that really change them (checked when Chip8::codeWrites
+  moves) throw every translation away
+- quirks are resolved while translating, switching the Chip8 to another profile throws every translation away too
+- every translated block is listed in /tmp/perf-<pid>.map so perf can name the samples
+
+Machine code conventions
+- rbx = Chip8*, r12d = instructions executed so far, r13d = instruction budget
+- rsi, rdi, rbp, r8-r11, r14, r15 = V registers used by the current block
+- rcx = I, rax and rdx = scratch
+- the code is only entered through the trampoline at the start of the buffer, which saves the callee-saved registers
+*/
+
+namespace x64 {
+    enum Reg : uint8_t {
+        RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+        R8, R9, R10, R11, R12, R13, R14, R15
+    };
+
+    // Condition codes for jcc/setcc
+    enum Cond : uint8_t {
+        COND_C = 0x2,
+        COND_E = 0x4,
+        COND_NE = 0x5,
+        COND_A = 0x7
+    };
+
+    // Opcodes of "op r/m8, r8"
+    enum ByteOp : uint8_t {
+        BYTE_ADD = 0x00,
+        BYTE_OR = 0x08,
+        BYTE_AND = 0x20,
+        BYTE_SUB = 0x28,
+        BYTE_XOR = 0x30,
+        BYTE_CMP = 0x38,
+        BYTE_MOV = 0x88
+    };
+
+    // ModRM reg field of the "op r/m8, imm8" (0x80) and shift (0xC0/0xD0) groups
+    enum GroupOp : uint8_t {
+        GROUP_ADD = 0,
+        GROUP_AND = 4,
+        GROUP_SHL = 4,
+        GROUP_SHR = 5,
+        GROUP_CMP = 7
+    };
+}
+
+// Appends x86-64 instructions to a fixed block of executable memory
+class Emitter {
+    public:
+        uint8_t* code{};
+        size_t capacity{};
+        size_t used{};
+
+        uint8_t* Here() { return code + used; }
+        size_t Free() const { return capacity - used; }
+
+        void Byte(uint8_t value) { code[used++] = value; }
+        void Word(uint16_t value) { memcpy(code + used, &value, 2); used += 2; }
+        void Dword(uint32_t value) { memcpy(code + used, &value, 4); used += 4; }
+        void Qword(uint64_t value) { memcpy(code + used, &value, 8); used += 8; }
+
+        void Rex(bool w, uint8_t reg, uint8_t index, uint8_t rm, bool force) {
+            uint8_t rex = 0x40 | (w << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (rm >> 3);
+
+            if (rex != 0x40 || force) {
+                Byte(rex);
+            }
+            /*
+            force is needed for byte registers: without a REX prefix 4-7 mean ah/ch/dh/bh instead of spl/bpl/sil/dil
+            */
+        }
+
+        void ModRM(uint8_t mod, uint8_t reg, uint8_t rm) { Byte((mod << 6) | ((reg & 7) << 3) | (rm & 7)); }
+
+        // [rbx + disp32]
+        void State(uint8_t reg, int32_t disp) { ModRM(2, reg, x64::RBX); Dword(disp); }
+
+        // movzx dst32, byte [rbx + disp]
+        void LoadByte(uint8_t dst, int32_t disp) { Rex(false, dst, 0, x64::RBX, false); Byte(0x0F); Byte(0xB6); State(dst, disp); }
+
+        // movzx dst32, word [rbx + disp]
+        void LoadWord(uint8_t dst, int32_t disp) { Rex(false, dst, 0, x64::RBX, false); Byte(0x0F); Byte(0xB7); State(dst, disp); }
+
+        // mov byte [rbx + disp], src8
+        void StoreByte(int32_t disp, uint8_t src) { Rex(false, src, 0, x64::RBX, true); Byte(0x88); State(src, disp); }
+
+        // mov word [rbx + disp], src16
+        void StoreWord(int32_t disp, uint8_t src) { Byte(0x66); Rex(false, src, 0, x64::RBX, false); Byte(0x89); State(src, disp); }
+
+        // mov word [rbx + disp], imm16
+        void StoreWordImm(int32_t disp, uint16_t value) { Byte(0x66); Byte(0xC7); State(0, disp); Word(value); }
+
+        // inc/dec byte [rbx + disp]
+        void IncByte(int32_t disp) { Byte(0xFE); State(0, disp); }
+        void DecByte(int32_t disp) { Byte(0xFE); State(1, disp); }
+
+        // op rm8, reg8
+        void ByteRegReg(x64::ByteOp op, uint8_t rm, uint8_t reg) { Rex(false, reg, 0, rm, true); Byte(op); ModRM(3, reg, rm); }
+
+        // op rm8, imm8
+        void ByteRegImm(x64::GroupOp op, uint8_t rm, uint8_t value) { Rex(false, 0, 0, rm, true); Byte(0x80); ModRM(3, op, rm); Byte(value); }
+
+        // mov rm8, imm8
+        void MovByteImm(uint8_t rm, uint8_t value) { Rex(false, 0, 0, rm, true); Byte(0xC6); ModRM(3, 0, rm); Byte(value); }
+
+        // shl/shr rm8, imm8
+        void ShiftByte(x64::GroupOp op, uint8_t rm, uint8_t count) {
+            Rex(false, 0, 0, rm, true);
+
+            if (count == 1) {
+                Byte(0xD0); ModRM(3, op, rm);
+            } else {
+                Byte(0xC0); ModRM(3, op, rm); Byte(count);
+            }
+        }
+
+        // setcc rm8
+        void Setcc(x64::Cond cond, uint8_t rm) { Rex(false, 0, 0, rm, true); Byte(0x0F); Byte(0x90 | cond); ModRM(3, 0, rm); }
+
+        // movzx dst32, src8
+        void MovzxByte(uint8_t dst, uint8_t src) { Rex(false, dst, 0, src, true); Byte(0x0F); Byte(0xB6); ModRM(3, dst, src); }
+
+        // mov dst32, src32
+        void Mov32(uint8_t dst, uint8_t src) { Rex(false, src, 0, dst, false); Byte(0x89); ModRM(3, src, dst); }
+
+        // mov dst32, imm32
+        void MovImm32(uint8_t dst, uint32_t value) { Rex(false, 0, 0, dst, false); Byte(0xB8 | (dst & 7)); Dword(value); }
+
+        // add dst32, src32
+        void Add32(uint8_t dst, uint8_t src) { Rex(false, src, 0, dst, false); Byte(0x01); ModRM(3, src, dst); }
+
+        // add dst32, imm32
+        void AddImm32(uint8_t dst, uint32_t value) { Rex(false, 0, 0, dst, false); Byte(0x81); ModRM(3, 0, dst); Dword(value); }
+
+        // cmp a32, b32
+        void Cmp32(uint8_t a, uint8_t b) { Rex(false, b, 0, a, false); Byte(0x39); ModRM(3, b, a); }
+
+        // jmp/jcc rel32, returns the location of rel32 so it can be patched
+        uint8_t* Jmp(uint8_t const* target) { Byte(0xE9); Dword(0); Patch(Here() - 4, target); return Here() - 4; }
+        uint8_t* Jcc(x64::Cond cond, uint8_t const* target) { Byte(0x0F); Byte(0x80 | cond); Dword(0); Patch(Here() - 4, target); return Here() - 4; }
+
+        static void Patch(uint8_t* site, uint8_t const* target) {
+            int32_t rel = static_cast<int32_t>(target - (site + 4));
+            memcpy(site, &rel, 4);
+        }
+};
+
+class Jit {
+    public:
+        explicit Jit(Chip8& chip8);
+        ~Jit();
+
+        Jit(Jit const&) = delete;
+        Jit& operator=(Jit const&) = delete;
+
+        // Same contract as Chip8::Run(), natively where possible
+        RunResult Run(uint32_t cycles, uint8_t stops = 0);
+
+        // Throw every translation away
+        void Flush();
+
+        // Blocks have to run this many times through the interpreter before they are translated
+        static const uint16_t HOT_THRESHOLD = 16;
+
+        Chip8& chip8;
+        uint32_t blocksCompiled{};
+        uint64_t nativeCycles{};
+        uint64_t interpretedCycles{};
+
+    private:
+        typedef uint32_t (*EntryFunc)(Chip8* chip8, uint32_t budget, uint8_t const* code);
+
+        static const uint16_t NO_NATIVE_CODE = 0xFFFF;
+        static const size_t CODE_SIZE = 1u << 20;
+        static const size_t MAX_BLOCK_CODE = 8192;
+
+        struct PendingExit {
+            uint16_t target;
+            uint8_t* site;
+        };
+
+        struct Translation {
+            uint16_t address;
+            uint16_t length;
+        };
+
+        struct Offsets {
+            int32_t registers;
+            int32_t index;
+            int32_t pc;
+            int32_t stack;
+            int32_t sp;
+        };
+
+        Emitter emit;
+        Offsets offsets{};
+        EntryFunc enter{};
+        uint8_t const* epilogue{};
+        size_t codeStart{};
+
+        // Entry of the translated block starting at each even address, or nullptr
+        uint8_t* entries[4096 / 2]{};
+        uint16_t hits[4096 / 2]{};
+        std::vector<PendingExit> pendingExits;
+
+        // Bytes every translation was made from, to tell real self-modification from rewrites of the same values
+        std::vector<Translation> translations;
+        uint8_t source[4096]{};
+        uint32_t seenCodeWrites{};
+        uint8_t quirks{}; // profile the current translations were made for
+        FILE* perfMap{};
+
+        uint8_t* Lookup(uint16_t address);
+        bool Compile(uint16_t address);
+        bool SourceChanged() const;
+        void EmitTrampoline();
+        void EmitExit(uint16_t target, uint8_t const* hostOf, uint16_t dirty, bool writesI);
+        void EmitStores(uint8_t const* hostOf, uint16_t dirty, bool writesI);
+        void EmitDynamicExit(uint8_t const* hostOf, uint16_t dirty, bool writesI);
+
+        static bool IsNative(uint8_t op);
+        static uint16_t RegistersUsed(Instruction ins, uint8_t quirks);
+        static uint16_t RegistersWritten(Instruction ins);
+};
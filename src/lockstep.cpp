@@ -0,0 +1,688 @@
+#include "lockstep.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CHIP8_LOCKSTEP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    // Eight lanes of a register row, GCC vector extensions turn the arithmetic on them into SSE2 code
+    typedef uint8_t Bytes __attribute__((vector_size(8)));
+    typedef uint16_t Words __attribute__((vector_size(16)));
+
+    const unsigned int VECTOR_LANES = 8;
+
+    inline Bytes LoadLanes(uint8_t const* row, unsigned int lane) {
+        Bytes value;
+        memcpy(&value, row + lane, sizeof(value));
+        return value;
+    }
+
+    inline Words LoadLanes(uint16_t const* row, unsigned int lane) {
+        Words value;
+        memcpy(&value, row + lane, sizeof(value));
+        return value;
+    }
+
+    inline Words Widen(Bytes value) {
+        return __builtin_convertvector(value, Words);
+    }
+
+    inline Bytes Narrow(Words value) {
+        return __builtin_convertvector(value, Bytes);
+    }
+
+    inline Bytes SplatBytes(uint8_t value) {
+        Bytes vector = {};
+        return vector + value;
+    }
+
+    inline Words SplatWords(uint16_t value) {
+        Words vector = {};
+        return vector + value;
+    }
+
+    // Stores the lanes of the current group: the mask is all ones for them and zero for the rest,
+    // when All is set every lane is in the group and the blend folds away
+    template <bool All>
+    inline void Put(uint8_t* row, unsigned int lane, Bytes value, uint8_t const* mask) {
+        if (!All) {
+            Bytes selected = LoadLanes(mask, lane);
+            value = (value & selected) | (LoadLanes(row, lane) & ~selected);
+        }
+
+        memcpy(row + lane, &value, sizeof(value));
+    }
+
+    template <bool All>
+    inline void Put(uint16_t* row, unsigned int lane, Words value, uint16_t const* mask) {
+        if (!All) {
+            Words selected = LoadLanes(mask, lane);
+            value = (value & selected) | (LoadLanes(row, lane) & ~selected);
+        }
+
+        memcpy(row + lane, &value, sizeof(value));
+    }
+
+    // Index of the highest pressed key, like the loop in OP_Fx0A, or -1: eight keys at a time, a byte is
+    // nonzero exactly when its top bit ends up set
+    inline int LastPressed(uint8_t const* keypad) {
+        uint64_t halves[2];
+        memcpy(halves, keypad, sizeof(halves));
+
+        for (int half = 1; half >= 0; --half) {
+            uint64_t const low = 0x7F7F7F7F7F7F7F7Full;
+            uint64_t pressed = (((halves[half] & low) + low) | halves[half]) & ~low;
+
+            if (pressed != 0) {
+                return half * 8 + (63 - __builtin_clzll(pressed)) / 8;
+            }
+        }
+
+        return -1;
+    }
+}
+
+template <unsigned int Lanes>
+Lockstep<Lanes>::Lockstep(Chip8 const& prototype) {
+    Reset(prototype);
+}
+
+template <unsigned int Lanes>
+void Lockstep<Lanes>::Reset(Chip8 const& prototype) {
+    for (unsigned int lane = 0; lane < Lanes; ++lane) {
+        machines[lane].SetState(prototype.State());
+        machines[lane].SetQuirks(prototype.quirks);
+    }
+
+    for (unsigned int i = 0; i < sizeof(decoded) / sizeof(decoded[0]); ++i) {
+        decoded[i].op = OP_ID_UNDECODED;
+    }
+
+    quirks = prototype.quirks;
+    loaded = false;
+    groups = 0;
+}
+
+template <unsigned int Lanes>
+Chip8& Lockstep<Lanes>::Lane(unsigned int lane) {
+    if (loaded) {
+        Store();
+        loaded = false;
+    }
+
+    return machines[lane];
+}
+
+template <unsigned int Lanes>
+void Lockstep<Lanes>::Load() {
+    converged = true;
+
+    for (unsigned int lane = 0; lane < Lanes; ++lane) {
+        Chip8 const& machine = machines[lane];
+
+        for (unsigned int r = 0; r < 16; ++r) {
+            v[r][lane] = machine.registers[r];
+        }
+
+        index[lane] = machine.index;
+        pc[lane] = machine.pc;
+        delayTimer[lane] = machine.delayTimer;
+        soundTimer[lane] = machine.soundTimer;
+        converged = converged && pc[lane] == pc[0];
+    }
+
+    elapsedCycles = machines[0].elapsedCycles;
+    timerPhase = machines[0].timerPhase;
+    instructionsPerSecond = machines[0].instructionsPerSecond;
+    loaded = true;
+}
+
+template <unsigned int Lanes>
+void Lockstep<Lanes>::Store() {
+    for (unsigned int lane = 0; lane < Lanes; ++lane) {
+        Chip8& machine = machines[lane];
+
+        for (unsigned int r = 0; r < 16; ++r) {
+            machine.registers[r] = v[r][lane];
+        }
+
+        machine.index = index[lane];
+        machine.pc = pc[lane];
+        machine.delayTimer = delayTimer[lane];
+        machine.soundTimer = soundTimer[lane];
+        machine.elapsedCycles = elapsedCycles;
+        machine.timerPhase = timerPhase;
+    }
+}
+
+template <unsigned int Lanes>
+void Lockstep<Lanes>::Run(uint32_t cycles) {
+    uint32_t const allLanes = Lanes == 32 ? 0xFFFFFFFFu : (1u << Lanes) - 1u;
+
+    if (!loaded) {
+        Load();
+    }
+
+    for (uint32_t cycle = 0; cycle < cycles; ++cycle) {
+        Step(allLanes);
+        TickTimers();
+    }
+    /*
+    - the lanes stay in the arrays between calls, a Run() per frame costs nothing extra
+    - the Chip8s are only brought up to date when Lane() hands one out
+    */
+}
+
+template <unsigned int Lanes>
+void Lockstep<Lanes>::Step(uint32_t const allLanes) {
+    // Every lane is on the same pc and the code there is shared: no grouping and no masks
+    if (converged) {
+        uint16_t address = pc[0];
+        Instruction ins = decoded[(address >> 1u) & 0x7FFu];
+
+        if ((address & 0xF001u) == 0 && ins.op != OP_ID_UNDECODED && ins.op != OP_ID_PER_LANE) {
+            converged = !Execute<true>(ins, address, allLanes, nullptr, nullptr);
+            ++groups;
+            return;
+        }
+    }
+
+    alignas(16) uint8_t mask8[Lanes];
+    alignas(16) uint16_t mask16[Lanes];
+    alignas(16) uint16_t pending[Lanes];
+    uint32_t remaining = allLanes;
+
+    memset(pending, 0xFF, sizeof(pending));
+
+    while (remaining != 0) {
+        unsigned int lead = static_cast<unsigned int>(__builtin_ctz(remaining));
+        uint16_t address = pc[lead];
+        uint32_t bits = Group(address, pending, mask8, mask16);
+        bool diverges = true;
+        Instruction ins;
+        ins.op = OP_ID_PER_LANE;
+
+        // Same rule as Chip8::Cycle(): only even addresses inside memory go through the decode table
+        if ((address & 0xF001u) == 0) {
+            Instruction& shared = decoded[address >> 1u];
+
+            if (shared.op == OP_ID_UNDECODED) {
+                uint8_t const* memory = machines[lead].memory;
+                shared = Chip8::Decode(static_cast<uint16_t>((memory[address] << 8u) | memory[address + 1]));
+            }
+
+            ins = shared;
+        }
+
+        if (ins.op != OP_ID_PER_LANE) {
+            diverges = Execute<false>(ins, address, bits, mask8, mask16);
+        } else {
+            // Each lane runs the instruction in its own memory, together with the lanes holding the same opcode
+            for (uint32_t rest = bits; rest != 0;) {
+                uint8_t const* memory = machines[__builtin_ctz(rest)].memory;
+                uint16_t opcode = static_cast<uint16_t>((memory[address] << 8u) | memory[address + 1]);
+                alignas(16) uint8_t same8[Lanes] = {};
+                alignas(16) uint16_t same16[Lanes] = {};
+                uint32_t same = 0;
+
+                for (uint32_t other = rest; other != 0; other &= other - 1) {
+                    unsigned int lane = static_cast<unsigned int>(__builtin_ctz(other));
+                    uint8_t const* code = machines[lane].memory + address;
+
+                    if (code[0] == memory[address] && code[1] == memory[address + 1]) {
+                        same |= 1u << lane;
+                        same8[lane] = 0xFFu;
+                        same16[lane] = 0xFFFFu;
+                    }
+                }
+
+                Execute<false>(Chip8::Decode(opcode), address, same, same8, same16);
+                rest &= ~same;
+            }
+        }
+
+        // The lanes met again on one pc, and this instruction kept them together
+        converged = bits == allLanes && !diverges;
+
+        for (unsigned int lane = 0; lane < Lanes; ++lane) {
+            pending[lane] &= static_cast<uint16_t>(~mask16[lane]);
+        }
+
+        remaining &= ~bits;
+        ++groups;
+    }
+    /*
+    - a group is every lane still pending in this cycle whose pc equals the pc of the first pending lane
+    - lanes that already ran in this cycle are never picked again, even if they jumped to the pc of a later group
+    - Execute() reports whether the lanes of a group may now be on different pcs (skips, returns, Bnnn, keys)
+    */
+}
+
+template <unsigned int Lanes>
+void Lockstep<Lanes>::TickTimers() {
+    // Chip8::TickTimers(1) for every lane at once
+    ++elapsedCycles;
+
+    uint64_t phase = timerPhase + static_cast<uint64_t>(TIMER_HZ);
+
+    if (phase < instructionsPerSecond) {
+        timerPhase = static_cast<uint32_t>(phase);
+        return;
+    }
+
+    uint64_t ticks = phase / instructionsPerSecond;
+    timerPhase = static_cast<uint32_t>(phase - ticks * instructionsPerSecond);
+
+    uint8_t step = ticks > 0xFFu ? 0xFFu : static_cast<uint8_t>(ticks);
+
+    for (unsigned int lane = 0; lane < Lanes; ++lane) {
+        delayTimer[lane] = delayTimer[lane] > step ? delayTimer[lane] - step : 0;
+        soundTimer[lane] = soundTimer[lane] > step ? soundTimer[lane] - step : 0;
+    }
+}
+
+template <unsigned int Lanes>
+uint32_t Lockstep<Lanes>::Group(uint16_t address, uint16_t const* pending, uint8_t* mask8, uint16_t* mask16) const {
+    uint32_t bits = 0;
+
+#ifdef CHIP8_LOCKSTEP_SSE2
+    __m128i target = _mm_set1_epi16(static_cast<short>(address));
+
+    // Eight lanes per compare, the 16-bit masks are packed down to the 8-bit ones and to one bit per lane
+    for (unsigned int lane = 0; lane < Lanes; lane += 8) {
+        __m128i at = _mm_cmpeq_epi16(_mm_load_si128(reinterpret_cast<__m128i const*>(pc + lane)), target);
+        at = _mm_and_si128(at, _mm_load_si128(reinterpret_cast<__m128i const*>(pending + lane)));
+        __m128i packed = _mm_packs_epi16(at, at);
+
+        _mm_store_si128(reinterpret_cast<__m128i*>(mask16 + lane), at);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(mask8 + lane), packed);
+        bits |= static_cast<uint32_t>(_mm_movemask_epi8(packed) & 0xFF) << lane;
+    }
+#else
+    for (unsigned int lane = 0; lane < Lanes; ++lane) {
+        bool at = pc[lane] == address && pending[lane] != 0;
+
+        mask16[lane] = at ? 0xFFFFu : 0;
+        mask8[lane] = at ? 0xFFu : 0;
+        bits |= static_cast<uint32_t>(at) << lane;
+    }
+#endif
+
+    return bits;
+}
+
+template <unsigned int Lanes>
+template <bool All>
+bool Lockstep<Lanes>::Execute(Instruction ins, uint16_t address, uint32_t bits, uint8_t const* mask8,
+        uint16_t const* mask16) {
+    Words const next = SplatWords(static_cast<uint16_t>(address + 2));
+    uint8_t* vx = v[ins.x];
+    uint8_t* vy = v[ins.y];
+    uint8_t* vf = v[0xF];
+    uint8_t* shifted = (quirks & QUIRK_SHIFT_VY) ? vy : vx;
+
+    switch (ins.op) {
+        case OP_ID_1nnn:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(pc, lane, SplatWords(ins.nnn()), mask16);
+            }
+
+            return false;
+
+        // A compare is all ones where it holds, masked down to the 2 a skip adds to pc
+        case OP_ID_3xkk:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(pc, lane, next + ((Words)(Widen(LoadLanes(vx, lane)) == ins.kk) & 2), mask16);
+            }
+
+            return true;
+
+        case OP_ID_4xkk:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(pc, lane, next + ((Words)(Widen(LoadLanes(vx, lane)) != ins.kk) & 2), mask16);
+            }
+
+            return true;
+
+        case OP_ID_5xy0:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Words equal = (Words)(Widen(LoadLanes(vx, lane)) == Widen(LoadLanes(vy, lane)));
+                Put<All>(pc, lane, next + (equal & 2), mask16);
+            }
+
+            return true;
+
+        case OP_ID_9xy0:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Words equal = (Words)(Widen(LoadLanes(vx, lane)) == Widen(LoadLanes(vy, lane)));
+                Put<All>(pc, lane, next + (~equal & 2), mask16);
+            }
+
+            return true;
+
+        case OP_ID_Bnnn: {
+            uint8_t const* base = v[(quirks & QUIRK_JUMP_VX) ? ins.x : 0];
+
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(pc, lane, Widen(LoadLanes(base, lane)) + ins.nnn(), mask16);
+            }
+
+            return true;
+        }
+
+        // The keypads stay in the lanes' Chip8s, a key is looked up one lane at a time but needs no handler call
+        case OP_ID_Ex9E:
+        case OP_ID_ExA1: {
+            alignas(16) uint16_t skip[Lanes];
+
+            for (unsigned int lane = 0; lane < Lanes; ++lane) {
+                skip[lane] = (machines[lane].keypad[vx[lane] & 0x0Fu] != 0) == (ins.op == OP_ID_Ex9E) ? 2 : 0;
+            }
+
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(pc, lane, next + LoadLanes(skip, lane), mask16);
+            }
+
+            return true;
+        }
+
+        case OP_ID_Fx0A: {
+            alignas(16) uint8_t key[Lanes];
+            alignas(16) uint16_t waiting[Lanes];
+
+            for (unsigned int lane = 0; lane < Lanes; ++lane) {
+                int pressed = LastPressed(machines[lane].keypad);
+
+                key[lane] = pressed < 0 ? vx[lane] : static_cast<uint8_t>(pressed);
+                waiting[lane] = pressed < 0 ? 0xFFFFu : 0;
+            }
+
+            // Lanes without a key stay on this instruction, like OP_Fx0A undoing the pc increment
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Words wait = LoadLanes(waiting, lane);
+
+                Put<All>(vx, lane, LoadLanes(key, lane), mask8);
+                Put<All>(pc, lane, (next & ~wait) | (SplatWords(address) & wait), mask16);
+            }
+
+            return true;
+        }
+
+        case OP_ID_6xkk:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(vx, lane, SplatBytes(ins.kk), mask8);
+            }
+
+            break;
+
+        case OP_ID_7xkk:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(vx, lane, LoadLanes(vx, lane) + ins.kk, mask8);
+            }
+
+            break;
+
+        case OP_ID_8xy0:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(vx, lane, LoadLanes(vy, lane), mask8);
+            }
+
+            break;
+
+        case OP_ID_8xy1:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(vx, lane, LoadLanes(vx, lane) | LoadLanes(vy, lane), mask8);
+            }
+
+            break;
+
+        case OP_ID_8xy2:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(vx, lane, LoadLanes(vx, lane) & LoadLanes(vy, lane), mask8);
+            }
+
+            break;
+
+        case OP_ID_8xy3:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(vx, lane, LoadLanes(vx, lane) ^ LoadLanes(vy, lane), mask8);
+            }
+
+            break;
+
+        // The flag is written first like the OP_* handlers do it; those that read their operands again afterwards
+        // see the flag when x or y is F, so the rows are loaded again for them too
+        case OP_ID_8xy4:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Words sum = Widen(LoadLanes(vx, lane)) + Widen(LoadLanes(vy, lane));
+
+                Put<All>(vf, lane, Narrow(sum >> 8), mask8);
+                Put<All>(vx, lane, Narrow(sum), mask8);
+            }
+
+            break;
+
+        case OP_ID_8xy5:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(vf, lane, (Bytes)(LoadLanes(vx, lane) > LoadLanes(vy, lane)) & 1, mask8);
+                Put<All>(vx, lane, LoadLanes(vx, lane) - LoadLanes(vy, lane), mask8);
+            }
+
+            break;
+
+        case OP_ID_8xy6:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(vf, lane, LoadLanes(shifted, lane) & 1, mask8);
+                Put<All>(vx, lane, LoadLanes(shifted, lane) >> 1, mask8);
+            }
+
+            break;
+
+        case OP_ID_8xy7:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(vf, lane, (Bytes)(LoadLanes(vy, lane) > LoadLanes(vx, lane)) & 1, mask8);
+                Put<All>(vx, lane, LoadLanes(vy, lane) - LoadLanes(vx, lane), mask8);
+            }
+
+            break;
+
+        case OP_ID_8xyE:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(vf, lane, LoadLanes(shifted, lane) >> 7, mask8);
+                Put<All>(vx, lane, LoadLanes(shifted, lane) << 1, mask8);
+            }
+
+            break;
+
+        case OP_ID_Annn:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(index, lane, SplatWords(ins.nnn()), mask16);
+            }
+
+            break;
+
+        case OP_ID_Fx07:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(vx, lane, LoadLanes(delayTimer, lane), mask8);
+            }
+
+            break;
+
+        case OP_ID_Fx15:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(delayTimer, lane, LoadLanes(vx, lane), mask8);
+            }
+
+            break;
+
+        case OP_ID_Fx18:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(soundTimer, lane, LoadLanes(vx, lane), mask8);
+            }
+
+            break;
+
+        case OP_ID_Fx1E:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(index, lane, LoadLanes(index, lane) + Widen(LoadLanes(vx, lane)), mask16);
+            }
+
+            break;
+
+        case OP_ID_Fx29:
+            for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+                Put<All>(index, lane, SplatWords(FONT_START_ADDRESS) + Widen(LoadLanes(vx, lane)) * 5, mask16);
+            }
+
+            break;
+
+        default:
+            // Memory, framebuffer, stack and the RNG live in each lane's own Chip8
+            for (uint32_t rest = bits; rest != 0; rest &= rest - 1) {
+                ExecuteLane(static_cast<unsigned int>(__builtin_ctz(rest)), ins);
+            }
+
+            // Every lane calls the same nnn, the rest only move on to the next instruction
+            return ins.op == OP_ID_00EE;
+    }
+
+    for (unsigned int lane = 0; lane < Lanes; lane += VECTOR_LANES) {
+        Put<All>(pc, lane, next, mask16);
+    }
+
+    return false;
+    /*
+    - every loop handles eight lanes per step with a blend and no branches, so divergent lanes cost no more
+      per instruction than converged ones, only the extra groups
+    - lanes outside the group keep their values, which is what makes divergent lanes safe to run in groups
+    - the key tests look at the keypads of lanes outside the group too, the blend drops their results; the key is
+      the low nibble of Vx as in Chip8::OP_Ex9E(), so any Vx such a lane holds stays inside its keypad
+    */
+}
+
+template <unsigned int Lanes>
+void Lockstep<Lanes>::ExecuteLane(unsigned int lane, Instruction ins) {
+    Chip8& machine = machines[lane];
+    unsigned int x = ins.x;
+
+    machine.pc = pc[lane] + 2;
+    machine.index = index[lane];
+
+    // Only the registers the handler reads go in
+    switch (ins.op) {
+        case OP_ID_00E0:
+        case OP_ID_00EE:
+        case OP_ID_2nnn:
+        case OP_ID_Cxkk:
+        case OP_ID_Fx65:
+            break;
+
+        case OP_ID_Dxyn:
+            machine.registers[ins.y] = v[ins.y][lane];
+            machine.registers[x] = v[x][lane];
+            break;
+
+        case OP_ID_Fx33:
+            machine.registers[x] = v[x][lane];
+            break;
+
+        case OP_ID_Fx55:
+            for (unsigned int r = 0; r <= x; ++r) {
+                machine.registers[r] = v[r][lane];
+            }
+
+            break;
+
+        default:
+            for (unsigned int r = 0; r < 16; ++r) {
+                machine.registers[r] = v[r][lane];
+            }
+
+            break;
+    }
+
+    uint16_t address = machine.index;
+    ((machine).*(machine.handlers[ins.op]))(ins);
+
+    // And only the ones it writes come back out
+    switch (ins.op) {
+        case OP_ID_00E0:
+        case OP_ID_00EE:
+        case OP_ID_2nnn:
+            break;
+
+        case OP_ID_Dxyn:
+            v[0xF][lane] = machine.registers[0xF];
+            break;
+
+        case OP_ID_Cxkk:
+            v[x][lane] = machine.registers[x];
+            break;
+
+        case OP_ID_Fx33:
+            // Code there may now differ between the lanes
+            MarkWritten(address, 3);
+            break;
+
+        case OP_ID_Fx55:
+            MarkWritten(address, x + 1);
+            break;
+
+        case OP_ID_Fx65:
+            for (unsigned int r = 0; r <= x; ++r) {
+                v[r][lane] = machine.registers[r];
+            }
+
+            break;
+
+        default:
+            for (unsigned int r = 0; r < 16; ++r) {
+                v[r][lane] = machine.registers[r];
+            }
+
+            break;
+    }
+
+    index[lane] = machine.index;
+    pc[lane] = machine.pc;
+    /*
+    - the handler runs on the lane's machine like Cycle() would run it, with pc already past the instruction
+    - none of these handlers looks at the timers, which only the arrays keep current
+    */
+}
+
+template <unsigned int Lanes>
+void Lockstep<Lanes>::MarkWritten(uint16_t address, unsigned int length) {
+    for (unsigned int i = address; i < address + length && i < sizeof(machines[0].memory); ++i) {
+        decoded[i >> 1u].op = OP_ID_PER_LANE;
+    }
+}
+
+template <unsigned int Lanes>
+void* Lockstep<Lanes>::operator new(size_t size) {
+    // Room to round up to 64 bytes and to keep what malloc returned just in front of the aligned block
+    void* raw = std::malloc(size + 64 + sizeof(void*));
+
+    if (!raw) {
+        throw std::bad_alloc();
+    }
+
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + 63u) & ~static_cast<uintptr_t>(63u);
+    reinterpret_cast<void**>(aligned)[-1] = raw;
+    return reinterpret_cast<void*>(aligned);
+}
+
+template <unsigned int Lanes>
+void Lockstep<Lanes>::operator delete(void* pointer) {
+    if (pointer) {
+        std::free(static_cast<void**>(pointer)[-1]);
+    }
+}
+
+template class Lockstep<8>;
+template class Lockstep<16>;
+template class Lockstep<32>;
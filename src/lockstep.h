@@ -0,0 +1,88 @@
+#pragma once
+
+#include "chip8.h"
+#include <cstddef>
+#include <cstdint>
+
+/*
+Lockstep engine: many copies of one ROM stepped together, one instruction per lane per cycle
+
+- V0-VF, I, pc and the timers are kept as struct of arrays, one row of Lanes values per register, so an
+  instruction runs for every lane at once with plain lane-wise loops the compiler turns into vector code
+- each cycle the lanes are grouped by pc, every group runs its instruction with a lane mask, so lanes that
+  took different branches are still correct, they just share less work until their pcs meet again
+- while every lane is on the same pc (the usual case for straight-line code) no grouping and no masking is done
+- arithmetic, jumps, skips, key tests, I and the timers run on the whole group; drawing, calls, the RNG and
+  memory access call the OP_* handler of each lane's own Chip8, which holds its memory, framebuffer, stack,
+  RNG and keypad, with only the registers that handler uses copied in and out
+- all lanes decode code from one shared table; bytes a lane writes with Fx33/Fx55 are marked, and code
+  there is decoded from each lane's own memory instead, lanes that hold the same opcode still run together
+- the lanes share one emulated clock (they all run the same number of cycles), so a timer tick is one
+  saturating subtract across all lanes
+
+Every lane ends up exactly where Lanes separate Chip8s calling Cycle() the same number of times would be.
+*/
+
+template <unsigned int Lanes>
+class Lockstep {
+    public:
+        static_assert(Lanes == 8 || Lanes == 16 || Lanes == 32, "Lockstep runs 8, 16 or 32 lanes");
+
+        // Every lane starts as a copy of the prototype's state, clock and quirk profile
+        explicit Lockstep(Chip8 const& prototype);
+
+        // Start every lane over from the prototype
+        void Reset(Chip8 const& prototype);
+
+        // Execute cycles instructions on every lane
+        void Run(uint32_t cycles);
+
+        // Bring the lane's Chip8 up to date and hand it out, the next Run() takes over anything changed in it
+        // except memory, instructionsPerSecond and quirks, which must stay what the prototype had
+        Chip8& Lane(unsigned int lane);
+
+        // Always current, and cheap enough to use every frame: no syncing involved
+        uint8_t* Keypad(unsigned int lane) { return machines[lane].keypad; }
+        uint64_t const* Video(unsigned int lane) const { return machines[lane].video; }
+
+        // Instruction groups executed so far, one per cycle while the lanes never diverge
+        uint64_t groups{};
+
+        // The lanes hold Chip8s, which need 64-byte alignment that plain new only gives from C++17 on
+        static void* operator new(size_t size);
+        static void operator delete(void* pointer);
+
+    private:
+        // Marks a shared decode entry whose bytes some lane has stored to, every lane decodes its own memory there
+        static const uint8_t OP_ID_PER_LANE = 0xFE;
+
+
+        alignas(64) uint8_t v[16][Lanes];
+        alignas(64) uint16_t index[Lanes];
+        alignas(64) uint16_t pc[Lanes];
+        alignas(64) uint8_t delayTimer[Lanes];
+        alignas(64) uint8_t soundTimer[Lanes];
+
+        // The clock every lane shares, see Chip8::TickTimers()
+        uint64_t elapsedCycles{};
+        uint32_t timerPhase{};
+        uint32_t instructionsPerSecond{};
+
+        // Decoded once for all lanes from the memory they still share, indexed like Chip8::decodeCache
+        Instruction decoded[4096 / 2];
+
+        uint8_t quirks{};
+        bool converged{};
+        bool loaded{};   // the arrays above are the lanes' state, the Chip8s are behind until Store()
+        Chip8 machines[Lanes];
+
+        void Load();
+        void Store();
+        void Step(uint32_t const allLanes);
+        void TickTimers();
+        void MarkWritten(uint16_t address, unsigned int length);
+        uint32_t Group(uint16_t address, uint16_t const* pending, uint8_t* mask8, uint16_t* mask16) const;
+        template <bool All> bool Execute(Instruction ins, uint16_t address, uint32_t bits, uint8_t const* mask8,
+            uint16_t const* mask16);
+        void ExecuteLane(unsigned int lane, Instruction ins);
+};
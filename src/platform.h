@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+struct SDL_Window;
+struct SDL_Renderer;
+struct SDL_Texture;
+
+class Platform
+{
+public:
+	Platform(char const* title, int windowWidth, int windowHeight, int textureWidth, int textureHeight);
+	~Platform();
+
+	void Update(void const* buffer, int pitch);
+
+	// True when the window was closed or Escape pressed
+	bool ProcessInput(uint8_t* keys);
+
+	// Backspace is held
+	bool rewinding{};
+
+private:
+	SDL_Window* window{};
+	SDL_Renderer* renderer{};
+	SDL_Texture* texture{};
+};
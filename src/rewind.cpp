@@ -0,0 +1,164 @@
+#include "rewind.h"
+#include <cstring>
+
+namespace {
+    uint8_t* PutVarint(uint8_t* out, size_t value) {
+        while (value >= 0x80u) {
+            *out++ = static_cast<uint8_t>(value | 0x80u);
+            value >>= 7u;
+        }
+
+        *out++ = static_cast<uint8_t>(value);
+        return out;
+    }
+
+    uint8_t const* GetVarint(uint8_t const* in, size_t& value) {
+        unsigned int shift = 0;
+        value = 0;
+
+        do {
+            value |= static_cast<size_t>(*in & 0x7Fu) << shift;
+            shift += 7;
+        } while (*in++ & 0x80u);
+
+        return in;
+    }
+}
+
+Rewind::Rewind(size_t budgetBytes, uint32_t maxFrames) : ring(budgetBytes), maxFrames(maxFrames) {
+    // Every token is at least MIN_GAP unchanged bytes apart, so the overhead stays well under the state size
+    scratch.resize(2 * CHIP8_STATE_BYTES + 16);
+}
+
+void Rewind::Clear() {
+    entries.clear();
+    writePos = 0;
+    bytesUsed = 0;
+    hasLatest = false;
+}
+
+void Rewind::Push(Chip8 const& chip8) {
+    uint8_t const* state = reinterpret_cast<uint8_t const*>(&chip8.State());
+
+    if (!hasLatest) {
+        memcpy(latest, state, CHIP8_STATE_BYTES);
+        hasLatest = true;
+        return;
+    }
+
+    size_t length = Encode(latest, state, CHIP8_STATE_BYTES, scratch.data());
+    memcpy(latest, state, CHIP8_STATE_BYTES);
+
+    if (length > ring.size() || maxFrames == 0) {
+        // Cannot be kept, and the older deltas would no longer lead back from the new state
+        entries.clear();
+        writePos = 0;
+        bytesUsed = 0;
+        return;
+    }
+
+    size_t offset = writePos + length <= ring.size() ? writePos : 0;
+
+    // Wrapping skips the end of the ring, the oldest entries still sit there and go first
+    while (offset != writePos && !entries.empty() && entries.front().offset >= writePos) {
+        bytesUsed -= entries.front().length;
+        entries.pop_front();
+    }
+
+    // Make room: the oldest entry is always the next one ahead of the write position
+    while (!entries.empty() && (entries.size() >= maxFrames || Overlaps(entries.front(), offset, length))) {
+        bytesUsed -= entries.front().length;
+        entries.pop_front();
+    }
+
+    memcpy(ring.data() + offset, scratch.data(), length);
+
+    Entry entry = {static_cast<uint32_t>(offset), static_cast<uint32_t>(length)};
+    entries.push_back(entry);
+    writePos = offset + length;
+    bytesUsed += length;
+}
+
+bool Rewind::StepBack(Chip8& chip8) {
+    if (entries.empty()) {
+        return false;
+    }
+
+    Entry entry = entries.back();
+    entries.pop_back();
+
+    Apply(latest, ring.data() + entry.offset, entry.length);
+    writePos = entry.offset;
+    bytesUsed -= entry.length;
+
+    chip8.RestoreState(latest);
+    return true;
+    /*
+    - XOR is its own inverse, so the delta that took frame n - 1 to frame n takes frame n back to n - 1
+    - the space of the newest delta is free again once it is applied, the next Push() writes over it
+    */
+}
+
+bool Rewind::Overlaps(Entry const& entry, size_t offset, size_t length) {
+    // Empty deltas (frames where nothing changed) still sit at a position and have to be dropped in order
+    return entry.offset < offset + length && (entry.offset >= offset || entry.offset + entry.length > offset);
+}
+
+size_t Rewind::Encode(uint8_t const* before, uint8_t const* after, size_t size, uint8_t* out) {
+    uint8_t* start = out;
+    size_t i = 0;
+
+    while (i < size) {
+        size_t gapStart = i;
+
+        while (i < size && before[i] == after[i]) {
+            ++i;
+        }
+
+        if (i == size) {
+            break;
+        }
+
+        // Extend the literal until MIN_GAP unchanged bytes in a row (or the end) follow
+        size_t literalStart = i;
+        size_t unchanged = 0;
+
+        while (i < size && unchanged < MIN_GAP) {
+            unchanged = before[i] == after[i] ? unchanged + 1 : 0;
+            ++i;
+        }
+
+        size_t literalEnd = i - unchanged;
+
+        out = PutVarint(out, literalStart - gapStart);
+        out = PutVarint(out, literalEnd - literalStart);
+
+        for (size_t j = literalStart; j < literalEnd; ++j) {
+            *out++ = before[j] ^ after[j];
+        }
+
+        i = literalEnd;
+    }
+
+    return static_cast<size_t>(out - start);
+}
+
+void Rewind::Apply(uint8_t* state, uint8_t const* delta, size_t length) {
+    uint8_t const* end = delta + length;
+    size_t position = 0;
+
+    while (delta < end) {
+        size_t gap;
+        size_t literal;
+        delta = GetVarint(delta, gap);
+        delta = GetVarint(delta, literal);
+        position += gap;
+
+        for (size_t j = 0; j < literal; ++j) {
+            state[position + j] ^= delta[j];
+        }
+
+        delta += literal;
+        position += literal;
+    }
+}
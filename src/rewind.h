@@ -0,0 +1,61 @@
+#pragma once
+
+#include "chip8.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/*
+Rewind history: the last frames of a Chip8 as a ring of XOR deltas
+
+- Push() once per frame XORs the new state against the previous one and run-length encodes the result
+- only the newest state is kept whole, each delta turns it back into the frame before, so StepBack() is one
+  decode of a few bytes plus Chip8::RestoreState()
+- deltas live in one fixed byte ring, the oldest frames are dropped when it is full or maxFrames is reached
+- a frame that only touches a few bytes of memory costs a few dozen bytes, so hours of history fit in a few MB
+
+Delta encoding: pairs of LEB128 varints (unchanged bytes to skip, changed bytes that follow), each followed by
+the XOR of those changed bytes. Unchanged gaps shorter than MIN_GAP stay inside the literal, a token for them
+would cost more than it saves.
+*/
+
+class Rewind {
+    public:
+        // budgetBytes bounds the ring of deltas, maxFrames how far back StepBack() may go
+        Rewind(size_t budgetBytes, uint32_t maxFrames);
+
+        // Record the state at the end of a frame
+        void Push(Chip8 const& chip8);
+
+        // Go back to the frame before the last one pushed, false once the history is used up
+        bool StepBack(Chip8& chip8);
+
+        void Clear();
+
+        uint32_t Frames() const { return static_cast<uint32_t>(entries.size()); }
+        size_t BytesUsed() const { return bytesUsed; }
+        size_t Capacity() const { return ring.size(); }
+
+    private:
+        static const size_t MIN_GAP = 4;
+
+        struct Entry {
+            uint32_t offset;
+            uint32_t length;
+        };
+
+        std::vector<uint8_t> ring;
+        std::deque<Entry> entries; // oldest first
+        size_t writePos{};
+        size_t bytesUsed{};
+        uint32_t maxFrames;
+
+        bool hasLatest{};
+        uint8_t latest[CHIP8_STATE_BYTES];
+        std::vector<uint8_t> scratch;
+
+        static bool Overlaps(Entry const& entry, size_t offset, size_t length);
+        static size_t Encode(uint8_t const* before, uint8_t const* after, size_t size, uint8_t* out);
+        static void Apply(uint8_t* state, uint8_t const* delta, size_t length);
+};
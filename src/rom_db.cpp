@@ -0,0 +1,59 @@
+#include "rom_db.h"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+bool RomDatabase::Load(char const* filename, std::string& error) {
+    std::ifstream file(filename);
+
+    if (!file.is_open()) {
+        error = std::string("Cannot open ") + filename;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(file, line)) {
+        ++lineNumber;
+
+        size_t first = line.find_first_not_of(" \t\r");
+
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::string hash;
+        std::string quirks;
+        RomInfo rom;
+        char* end;
+
+        fields >> hash >> quirks;
+        rom.hash = strtoull(hash.c_str(), &end, 16);
+
+        if (hash.size() != 16 || *end != '\0' || !ParseQuirks(quirks.c_str(), rom.quirks)) {
+            error = std::string(filename) + ":" + std::to_string(lineNumber) + ": expected <Hash> <Quirks> <Title>";
+            return false;
+        }
+
+        std::getline(fields >> std::ws, rom.title);
+
+        // Windows line endings
+        if (!rom.title.empty() && rom.title.back() == '\r') {
+            rom.title.pop_back();
+        }
+
+        roms[rom.hash] = rom;
+    }
+
+    return true;
+    /*
+    - a hash listed twice keeps its last line, so a local file loaded after a shared one can override it
+    */
+}
+
+RomInfo const* RomDatabase::Find(uint64_t hash) const {
+    std::unordered_map<uint64_t, RomInfo>::const_iterator rom = roms.find(hash);
+    return rom == roms.end() ? nullptr : &rom->second;
+}
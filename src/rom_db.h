@@ -0,0 +1,36 @@
+#pragma once
+
+#include "chip8.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+/*
+ROM database: what is known about a ROM, looked up by its content hash (HashROM(), Chip8::romHash)
+
+One ROM per line, "<Hash> <Quirks> <Title>":
+- Hash is the 16 hex digits of HashROM(), Quirks anything ParseQuirks() accepts, the title is the rest of the line
+- blank lines and lines starting with # are ignored
+
+A renamed or copied ROM is still found, a patched one is a different ROM.
+*/
+
+struct RomInfo {
+    uint64_t hash;
+    uint8_t quirks;
+    std::string title;
+};
+
+class RomDatabase {
+    public:
+        // Adds every ROM of the file, false with the file and line in error when it cannot be read or parsed
+        bool Load(char const* filename, std::string& error);
+
+        // nullptr for a ROM that is not listed
+        RomInfo const* Find(uint64_t hash) const;
+
+        size_t Size() const { return roms.size(); }
+
+    private:
+        std::unordered_map<uint64_t, RomInfo> roms;
+};
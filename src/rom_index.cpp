@@ -0,0 +1,319 @@
+#include "rom_index.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// False when the file cannot be opened, view is nullptr when it is too short or cannot be mapped
+static bool MapFile(char const* filename, size_t minimum, void*& view, size_t& bytes) {
+    int file = open(filename, O_RDONLY | O_CLOEXEC);
+    struct stat info;
+
+    if (file < 0 || fstat(file, &info) != 0) {
+        if (file >= 0) {
+            close(file);
+        }
+
+        return false;
+    }
+
+    bytes = static_cast<size_t>(info.st_size);
+    view = bytes >= minimum ? mmap(nullptr, bytes, PROT_READ, MAP_SHARED, file, 0) : MAP_FAILED;
+    close(file);
+
+    if (view == MAP_FAILED) {
+        view = nullptr;
+    }
+
+    return true;
+}
+
+static void UnmapFile(void* view, size_t bytes) {
+    munmap(view, bytes);
+}
+#else
+#include <fstream>
+
+// Without mmap the index is read into one heap block, same interface, nothing shared between processes
+static bool MapFile(char const* filename, size_t minimum, void*& view, size_t& bytes) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::streamoff end = file.tellg();
+    view = nullptr;
+    bytes = end > 0 ? static_cast<size_t>(end) : 0;
+
+    if (end < 0 || bytes < minimum || !(view = std::malloc(bytes))) {
+        view = nullptr;
+        return true;
+    }
+
+    file.seekg(0, std::ios::beg);
+
+    if (!file.read(static_cast<char*>(view), static_cast<std::streamsize>(bytes))) {
+        std::free(view);
+        view = nullptr;
+    }
+
+    return true;
+}
+
+static void UnmapFile(void* view, size_t) {
+    std::free(view);
+}
+#endif
+
+// Exact decoding, Chip8::DecodeOp() only tells the instructions the core runs apart and maps the rest loosely
+static uint8_t Classify(uint16_t opcode) {
+    switch (opcode >> 12u) {
+        case 0x0:
+            switch (opcode) {
+                case 0x0000: return OP_ID_NULL;
+                case 0x00E0: return OP_ID_00E0;
+                case 0x00EE: return OP_ID_00EE;
+                case 0x00FB:
+                case 0x00FC: return ROM_OP_SCROLL_SIDE;
+                case 0x00FD: return ROM_OP_EXIT;
+                case 0x00FE:
+                case 0x00FF: return ROM_OP_RESOLUTION;
+            }
+            switch (opcode & 0xFFF0u) {
+                case 0x00C0: return ROM_OP_SCROLL_DOWN;
+                case 0x00D0: return ROM_OP_SCROLL_UP;
+            }
+            return ROM_OP_SYS;
+        case 0x5:
+            switch (opcode & 0x000Fu) {
+                case 0x0: return OP_ID_5xy0;
+                case 0x2:
+                case 0x3: return ROM_OP_REGISTER_RANGE;
+            }
+            return OP_ID_NULL;
+        case 0x9:
+            return (opcode & 0x000Fu) == 0x0 ? OP_ID_9xy0 : OP_ID_NULL;
+        case 0xD:
+            switch (opcode & 0x000Fu) {
+                case 0x0: return ROM_OP_SPRITE16;
+            }
+            return OP_ID_Dxyn;
+        case 0xE:
+            switch (opcode & 0x00FFu) {
+                case 0x9E: return OP_ID_Ex9E;
+                case 0xA1: return OP_ID_ExA1;
+            }
+            return OP_ID_NULL;
+        case 0xF:
+            switch (opcode) {
+                case 0xF000: return ROM_OP_LONG_I;
+                case 0xF002: return ROM_OP_AUDIO;
+            }
+            switch (opcode & 0x00FFu) {
+                case 0x01: return ROM_OP_PLANE;
+                case 0x30: return ROM_OP_BIG_FONT;
+                case 0x3A: return ROM_OP_AUDIO;
+                case 0x75:
+                case 0x85: return ROM_OP_USER_FLAGS;
+            }
+            break;
+    }
+
+    return Chip8::DecodeOp(opcode);
+    /*
+    - 0000 is counted as unknown rather than as a machine code call, it is what padding and zeroed data look like
+    - F002 (load the audio pattern) shares a class with Fx3A (set the pitch)
+    */
+}
+
+static bool IsSkip(uint8_t op) {
+    return op == OP_ID_3xkk || op == OP_ID_4xkk || op == OP_ID_5xy0 || op == OP_ID_9xy0
+        || op == OP_ID_Ex9E || op == OP_ID_ExA1;
+}
+
+static bool UsesI(uint8_t op) {
+    return op == OP_ID_Dxyn || op == OP_ID_Fx1E || op == OP_ID_Fx33 || op == OP_ID_Fx55 || op == OP_ID_Fx65
+        || op == ROM_OP_SPRITE16 || op == ROM_OP_REGISTER_RANGE;
+}
+
+static bool SetsI(uint8_t op) {
+    return op == OP_ID_Annn || op == OP_ID_Fx29 || op == ROM_OP_BIG_FONT || op == ROM_OP_LONG_I;
+}
+
+void AnalyzeROM(uint8_t const* rom, size_t size, RomIndexEntry& entry) {
+    uint32_t end = START_ADDRESS + static_cast<uint32_t>(std::min(size, MAX_INDEXED_ROM_SIZE));
+
+    // Opcode at an address inside the ROM, 0 (unknown) past its end
+    auto opcodeAt = [&](uint32_t address) -> uint16_t {
+        return address >= START_ADDRESS && address + 2u <= end
+            ? static_cast<uint16_t>((rom[address - START_ADDRESS] << 8u) | rom[address - START_ADDRESS + 1])
+            : 0;
+    };
+
+    auto lengthAt = [&](uint32_t address) -> uint32_t {
+        return opcodeAt(address) == 0xF000u ? 4u : 2u;
+    };
+
+    entry.hash = HashROM(rom, size);
+    entry.size = static_cast<uint32_t>(size);
+    entry.instructions = 0;
+    entry.features = size > 0 && size <= MAX_ROM_SIZE ? ROM_FITS : 0;
+    memset(entry.histogram, 0, sizeof(entry.histogram));
+
+    // Every path from START_ADDRESS, each address decoded once
+    std::vector<bool> seen(end - START_ADDRESS);
+    std::vector<uint32_t> work(1, START_ADDRESS);
+
+    while (!work.empty()) {
+        uint32_t address = work.back();
+        work.pop_back();
+
+        if (address < START_ADDRESS || address + 2u > end || seen[address - START_ADDRESS]) {
+            continue;
+        }
+
+        seen[address - START_ADDRESS] = true;
+
+        uint16_t opcode = opcodeAt(address);
+        uint8_t op = Classify(opcode);
+        uint32_t next = address + lengthAt(address);
+
+        ++entry.instructions;
+        ++entry.histogram[op];
+
+        if (op >= ROM_OP_SCROLL_DOWN && op <= ROM_OP_USER_FLAGS) {
+            entry.features |= ROM_USES_SCHIP;
+        } else if (op >= ROM_OP_SCROLL_UP) {
+            entry.features |= ROM_USES_XOCHIP;
+        }
+
+        if ((op == OP_ID_8xy6 || op == OP_ID_8xyE) && ((opcode >> 8u) & 0xFu) != ((opcode >> 4u) & 0xFu)) {
+            entry.features |= ROM_SHIFTS_VY;
+        }
+
+        // Straight on after a load or store: I used before anything sets it again counts on the increment
+        if (op == OP_ID_Fx55 || op == OP_ID_Fx65) {
+            for (uint32_t after = next, count = 0; count < 8 && after + 2u <= end; after += lengthAt(after), ++count) {
+                uint8_t use = Classify(opcodeAt(after));
+
+                if (UsesI(use)) {
+                    entry.features |= ROM_REUSES_I;
+                }
+
+                if (UsesI(use) || SetsI(use) || use >= ROM_OP_SYS || Chip8::EndsBlock(use)) {
+                    break;
+                }
+            }
+        }
+
+        switch (op) {
+            case OP_ID_1nnn:
+                work.push_back(opcode & 0x0FFFu);
+                break;
+            case OP_ID_2nnn:
+                work.push_back(opcode & 0x0FFFu);
+                work.push_back(next);
+                break;
+            case OP_ID_00EE:
+            case OP_ID_Bnnn:
+            case OP_ID_NULL:
+            case ROM_OP_EXIT:
+                break;
+            default:
+                work.push_back(next);
+
+                if (IsSkip(op)) {
+                    work.push_back(next + lengthAt(next));
+                }
+                break;
+        }
+    }
+
+    uint8_t profile = 0;
+
+    if (entry.features & ROM_USES_XOCHIP) {
+        ParseQuirks("xochip", profile);
+    } else if (entry.features & ROM_USES_SCHIP) {
+        ParseQuirks("schip", profile);
+    } else {
+        profile = ((entry.features & ROM_SHIFTS_VY) ? QUIRK_SHIFT_VY : 0)
+            | ((entry.features & ROM_REUSES_I) ? QUIRK_LOAD_STORE_I : 0);
+    }
+
+    entry.quirks = profile;
+    /*
+    - only what is reachable counts, sprites and other data between the code stay out of the histogram
+    - Bnnn and 00EE end a path, their targets are only known at runtime (returns land after the 2nnn anyway)
+    - an unknown opcode ends a path too, it is usually data a skip or the end of a table ran into
+    - the profile is a guess: XO-CHIP or SUPER-CHIP instructions pick that profile, a plain CHIP-8 ROM gets the
+      COSMAC behaviour whose traces it shows (8xy6 with x != y, I reused after Fx55/Fx65) and modern otherwise
+    */
+}
+
+RomIndex::~RomIndex() {
+    if (mapping) {
+        UnmapFile(mapping, mappingBytes);
+    }
+}
+
+bool RomIndex::Open(char const* filename, std::string& error) {
+    if (mapping) {
+        UnmapFile(mapping, mappingBytes);
+        mapping = nullptr;
+        count = 0;
+    }
+
+    void* mapped;
+    size_t bytes;
+
+    if (!MapFile(filename, sizeof(RomIndexHeader), mapped, bytes)) {
+        error = std::string("Cannot open ") + filename;
+        return false;
+    }
+
+    if (!mapped) {
+        error = std::string(filename) + " is not a ROM index";
+        return false;
+    }
+
+    RomIndexHeader const* header = static_cast<RomIndexHeader const*>(mapped);
+    size_t entriesBytes = static_cast<size_t>(header->count) * sizeof(RomIndexEntry);
+    char const* pathTable = static_cast<char const*>(mapped) + sizeof(RomIndexHeader) + entriesBytes;
+
+    if (memcmp(header->magic, "C8IX", 4) != 0 || header->version != ROM_INDEX_VERSION
+        || header->entryBytes != sizeof(RomIndexEntry)
+        || sizeof(RomIndexHeader) + entriesBytes + header->pathBytes != bytes
+        || (header->pathBytes > 0 && pathTable[header->pathBytes - 1] != '\0')) {
+        UnmapFile(mapped, bytes);
+        error = std::string(filename) + " is not a ROM index of this version";
+        return false;
+    }
+
+    mapping = mapped;
+    mappingBytes = bytes;
+    count = header->count;
+    entries = reinterpret_cast<RomIndexEntry const*>(header + 1);
+    paths = pathTable;
+    return true;
+    /*
+    - a shared read-only mapping: every process that opens the same index shares its pages (where there is no
+      mmap, see MapFile(), the file is read into memory instead)
+    - chip8-index replaces the file with rename(), so a mapping that is open stays valid (and stale) meanwhile
+    - paths are only checked to end in a NUL, an entry's offset is trusted like the rest of the file
+    */
+}
+
+RomIndexEntry const* RomIndex::Find(uint64_t hash) const {
+    RomIndexEntry const* last = entries + count;
+    RomIndexEntry const* entry = std::lower_bound(entries, last, hash,
+        [](RomIndexEntry const& a, uint64_t b) { return a.hash < b; });
+
+    return entry != last && entry->hash == hash ? entry : nullptr;
+}
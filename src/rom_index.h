@@ -0,0 +1,98 @@
+#pragma once
+
+#include "chip8.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ROM index: what chip8-index found out about every ROM of a library, in one file that is used memory-mapped
+
+File layout, everything in host byte order:
+- RomIndexHeader
+- count RomIndexEntry, sorted by hash so Find() is a binary search
+- pathBytes of NUL-terminated paths, RomIndexEntry::path is an offset in there
+
+Nothing is parsed or copied when the file is opened, a lookup touches a few pages of the mapping.
+*/
+
+// Histogram classes: the OpId of every CHIP-8 instruction, then the extensions this core does not run
+enum RomOpClass : uint8_t {
+    ROM_OP_SYS = OP_ID_COUNT, // 0nnn, machine code call on the COSMAC VIP
+    ROM_OP_SCROLL_DOWN,       // 00Cn                 (SUPER-CHIP)
+    ROM_OP_SCROLL_SIDE,       // 00FB, 00FC           (SUPER-CHIP)
+    ROM_OP_EXIT,              // 00FD                 (SUPER-CHIP)
+    ROM_OP_RESOLUTION,        // 00FE, 00FF           (SUPER-CHIP)
+    ROM_OP_SPRITE16,          // Dxy0                 (SUPER-CHIP)
+    ROM_OP_BIG_FONT,          // Fx30                 (SUPER-CHIP)
+    ROM_OP_USER_FLAGS,        // Fx75, Fx85           (SUPER-CHIP)
+    ROM_OP_SCROLL_UP,         // 00Dn                 (XO-CHIP)
+    ROM_OP_REGISTER_RANGE,    // 5xy2, 5xy3           (XO-CHIP)
+    ROM_OP_LONG_I,            // F000 nnnn            (XO-CHIP)
+    ROM_OP_PLANE,             // Fn01                 (XO-CHIP)
+    ROM_OP_AUDIO,             // F002, Fx3A           (XO-CHIP)
+    ROM_OP_CLASSES
+};
+
+// What the analysis saw, RomIndexEntry::features
+enum RomFeatures : uint8_t {
+    ROM_FITS = 1u << 0,        // at most MAX_ROM_SIZE bytes, Chip8::LoadROM() takes it
+    ROM_USES_SCHIP = 1u << 1,  // reaches a SUPER-CHIP instruction
+    ROM_USES_XOCHIP = 1u << 2, // reaches an XO-CHIP instruction
+    ROM_SHIFTS_VY = 1u << 3,   // reaches an 8xy6/8xyE with x != y
+    ROM_REUSES_I = 1u << 4     // uses I again right after an Fx55/Fx65 without setting it
+};
+
+struct RomIndexHeader {
+    char magic[4];        // "C8IX"
+    uint16_t version;     // ROM_INDEX_VERSION
+    uint16_t entryBytes;  // sizeof(RomIndexEntry) of the writer
+    uint32_t count;
+    uint32_t pathBytes;
+};
+
+struct RomIndexEntry {
+    uint64_t hash;          // HashROM() of the whole file, Chip8::romHash once it is loaded
+    int64_t modified;       // mtime in ns, with path and size it tells chip8-index the file is unchanged
+    uint32_t path;
+    uint32_t size;
+    uint16_t instructions;  // reachable from START_ADDRESS
+    uint8_t quirks;         // guessed profile
+    uint8_t features;       // RomFeatures
+    uint16_t histogram[ROM_OP_CLASSES]; // reachable instructions of each RomOpClass
+};
+
+// Bump whenever RomIndexHeader or RomIndexEntry changes
+const uint16_t ROM_INDEX_VERSION = 1;
+
+// Largest file chip8-index looks at: all of XO-CHIP's 64K address space above START_ADDRESS
+const size_t MAX_INDEXED_ROM_SIZE = 0x10000 - START_ADDRESS;
+
+// Fills everything but path and modified from the ROM image alone
+void AnalyzeROM(uint8_t const* rom, size_t size, RomIndexEntry& entry);
+
+class RomIndex {
+    public:
+        RomIndex() {}
+        ~RomIndex();
+
+        RomIndex(RomIndex const&) = delete;
+        RomIndex& operator=(RomIndex const&) = delete;
+
+        // Maps the file, false with the reason when it is missing or not an index of this version
+        bool Open(char const* filename, std::string& error);
+
+        size_t Size() const { return count; }
+        RomIndexEntry const& Entry(size_t index) const { return entries[index]; }
+        char const* Path(RomIndexEntry const& entry) const { return paths + entry.path; }
+
+        // First entry of the ROM (copies at other paths follow it), nullptr when it is not indexed
+        RomIndexEntry const* Find(uint64_t hash) const;
+
+    private:
+        void* mapping{};
+        size_t mappingBytes{};
+        size_t count{};
+        RomIndexEntry const* entries{};
+        char const* paths{};
+};
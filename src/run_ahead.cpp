@@ -0,0 +1,37 @@
+#include "run_ahead.h"
+#include <cstring>
+
+RunAhead::RunAhead(Chip8& chip8, Jit* jit, uint32_t frames) : frames(frames), chip8(chip8), jit(jit) {}
+
+void RunAhead::Frame(uint32_t cycles, uint32_t* pixels) {
+    Run(cycles);
+
+    if (frames == 0) {
+        chip8.Render(pixels);
+        return;
+    }
+
+    memcpy(snapshot, &chip8.State(), CHIP8_STATE_BYTES);
+    uint64_t skippedCycles = chip8.skippedCycles;
+
+    for (uint32_t frame = 0; frame < frames; ++frame) {
+        Run(cycles);
+    }
+
+    chip8.Render(pixels);
+    chip8.RestoreState(snapshot);
+    chip8.skippedCycles = skippedCycles;
+    /*
+    - the frames ahead see the keypad as it is now, which is the guess run-ahead makes: keys stay as they are
+    - skippedCycles is not part of the state but should only count what the real frames skipped
+    - memory the frames ahead wrote is rolled back by RestoreState(), which also drops any code decoded from it
+    */
+}
+
+void RunAhead::Run(uint32_t cycles) {
+    if (jit) {
+        jit->Run(cycles);
+    } else {
+        chip8.Run(cycles);
+    }
+}
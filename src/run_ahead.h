@@ -0,0 +1,35 @@
+#pragma once
+
+#include "chip8.h"
+#include "jit_x64.h"
+#include <cstdint>
+
+/*
+Run-ahead: show the frame the game will draw a few frames from now to hide the lag built into the ROM
+
+- many ROMs only react to a key one or more frames after they read it, run-ahead presents that later frame
+  right away, with the keys held now, so a press shows up on screen whole frames earlier
+- each frame runs the real frame, snapshots the state, runs frames more, renders, and restores the snapshot
+- the snapshot is one memcpy of CHIP8_STATE_BYTES and the restore is Chip8::RestoreState(), which keeps the
+  decode cache (and so the JIT) wherever the frames ahead did not write memory
+- the machine only ever advances by the real frames, rewind, save states and replays see the same run as without
+*/
+
+class RunAhead {
+    public:
+        // jit may be null, frames is how far ahead of the real frame the picture is, 0 turns run-ahead off
+        RunAhead(Chip8& chip8, Jit* jit, uint32_t frames);
+
+        // Run one real frame of cycles and render the picture to show for it into pixels
+        void Frame(uint32_t cycles, uint32_t* pixels);
+
+        uint32_t frames;
+
+    private:
+        Chip8& chip8;
+        Jit* jit;
+
+        alignas(64) uint8_t snapshot[CHIP8_STATE_BYTES];
+
+        void Run(uint32_t cycles);
+};
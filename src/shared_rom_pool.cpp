@@ -0,0 +1,123 @@
+#include "shared_rom_pool.h"
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+SharedRomPool::SharedRomPool(Chip8 const& prototype, size_t count) : count(count) {
+    pageBytes = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    // memory[] starts as close before a page boundary as the 64-byte alignment of Chip8 allows (32 bytes), the
+    // state before it takes the tail of the page before
+    size_t memoryOffset = offsetof(Chip8State, memory);
+    objectOffset = (pageBytes - memoryOffset % pageBytes) % pageBytes / alignof(Chip8) * alignof(Chip8);
+    slotBytes = (objectOffset + sizeof(Chip8) + pageBytes - 1) / pageBytes * pageBytes;
+
+    int image = memfd_create("chip8-shared-rom", MFD_CLOEXEC);
+
+    if (image < 0 || ftruncate(image, static_cast<off_t>(slotBytes)) != 0) {
+        if (image >= 0) {
+            close(image);
+        }
+
+        throw std::bad_alloc();
+    }
+
+    void* writable = mmap(nullptr, slotBytes, PROT_READ | PROT_WRITE, MAP_SHARED, image, 0);
+
+    if (writable == MAP_FAILED) {
+        close(image);
+        throw std::bad_alloc();
+    }
+
+    Chip8* shared = new (static_cast<uint8_t*>(writable) + objectOffset) Chip8(prototype);
+
+    // Decoded up front, so instances only write decode pages when they overwrite code there
+    for (unsigned int address = 0; address < sizeof(shared->memory); address += 2) {
+        shared->BlockLength(static_cast<uint16_t>(address));
+    }
+
+    munmap(writable, slotBytes);
+
+    // One reservation keeps the slots together, each slot is then replaced by a private mapping of the image
+    void* reserved = mmap(nullptr, slotBytes * count, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if (reserved == MAP_FAILED) {
+        close(image);
+        throw std::bad_alloc();
+    }
+
+    slots = static_cast<uint8_t*>(reserved);
+
+    for (size_t instance = 0; instance < count; ++instance) {
+        void* slot = mmap(slots + instance * slotBytes, slotBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+            image, 0);
+
+        if (slot == MAP_FAILED) {
+            munmap(slots, slotBytes * count);
+            close(image);
+            throw std::bad_alloc();
+        }
+    }
+
+    close(image);
+    /*
+    - the mappings keep the memfd alive, the descriptor itself is not needed any more
+    - decoding every even address decodes data as well, harmless: a decoded entry is only a cache of memory,
+      and a write there invalidates it like it invalidates code
+    - every slot is its own mapping, so count is bounded by vm.max_map_count (65530 by default)
+    */
+}
+
+SharedRomPool::~SharedRomPool() {
+    munmap(slots, slotBytes * count);
+}
+
+Chip8& SharedRomPool::Instance(size_t instance) {
+    return *reinterpret_cast<Chip8*>(slots + instance * slotBytes + objectOffset);
+}
+
+void SharedRomPool::Reset(size_t instance) {
+    // A private file mapping reads the file again after MADV_DONTNEED, the copies are simply dropped
+    madvise(slots + instance * slotBytes, slotBytes, MADV_DONTNEED);
+}
+
+bool SharedRomPool::Resident(size_t instance, Residency& residency) const {
+    int pagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+
+    if (pagemap < 0) {
+        return false;
+    }
+
+    size_t pages = slotBytes / pageBytes;
+    size_t first = reinterpret_cast<uintptr_t>(slots + instance * slotBytes) / pageBytes;
+    uint64_t entries[64];
+    bool ok = pages <= sizeof(entries) / sizeof(entries[0])
+        && pread(pagemap, entries, pages * sizeof(uint64_t), static_cast<off_t>(first * sizeof(uint64_t)))
+            == static_cast<ssize_t>(pages * sizeof(uint64_t));
+
+    close(pagemap);
+
+    if (!ok) {
+        return false;
+    }
+
+    residency.privateBytes = 0;
+    residency.sharedBytes = 0;
+
+    for (size_t page = 0; page < pages; ++page) {
+        bool present = (entries[page] >> 63) & 1u;
+        bool fromImage = (entries[page] >> 61) & 1u;
+
+        if (present) {
+            (fromImage ? residency.sharedBytes : residency.privateBytes) += pageBytes;
+        }
+    }
+
+    return true;
+    /*
+    - bit 63 of a pagemap entry is set for a page in RAM, bit 61 for a page of a file (here: the image) as
+      opposed to an anonymous one, which is what a copy-on-write copy is
+    - pages the instance never touched are in neither count, they exist once in the image
+    */
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "chip8.h"
+#include <cstddef>
+#include <cstdint>
+
+/*
+Shared ROM pool: many Chip8s of one ROM that share every page none of them has written to
+
+- the prototype is copied once into an image in shared memory, with its whole memory already decoded, and
+  every instance maps that image copy-on-write: the kernel gives an instance its own copy of a page the
+  first time it writes there (Fx33/Fx55 into memory, anything into its registers) and keeps sharing the rest
+- each instance is placed so that memory[] and decodeCache[] line up with pages (up to their first 32 bytes),
+  the ROM and font page and the decode pages of code nobody overwrote stay shared however long they run
+- the registers, timers, keypad and framebuffer sit alone at the end of the page before memory, they are
+  written all the time and are the one page every instance always owns; Run() writes outside it only when it
+  skips an idle loop (Chip8::skippedCycles) or the program stores to memory
+- instances are plain Chip8s, everything that works on a Chip8 works on them unchanged
+
+Linux only: the image is a memfd, residency comes from /proc/self/pagemap. It is built as its own library,
+libchip8-shared-rom, so libchip8 and the frontend still build elsewhere.
+*/
+
+// RAM an instance uses right now, in bytes: its own copies, and pages it still shares with the image
+struct Residency {
+    size_t privateBytes;
+    size_t sharedBytes;
+};
+
+class SharedRomPool {
+    public:
+        // count instances that start as copies of the prototype, quirk profile and engine included
+        SharedRomPool(Chip8 const& prototype, size_t count);
+        ~SharedRomPool();
+
+        SharedRomPool(SharedRomPool const&) = delete;
+        SharedRomPool& operator=(SharedRomPool const&) = delete;
+
+        Chip8& Instance(size_t instance);
+        size_t Size() const { return count; }
+
+        // Drop the instance's private pages, it is the prototype again and shares every page
+        void Reset(size_t instance);
+
+        // False when /proc/self/pagemap cannot be read
+        bool Resident(size_t instance, Residency& residency) const;
+
+        // Address space one instance takes, and the shared image is the same size once for the whole pool
+        size_t SlotBytes() const { return slotBytes; }
+
+    private:
+        size_t count;
+        size_t pageBytes;
+        size_t slotBytes;
+        size_t objectOffset;   // where the Chip8 starts inside its slot
+        uint8_t* slots;
+};
@@ -0,0 +1,71 @@
+#include "vector_env.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+VectorEnv::VectorEnv(Chip8 const& prototype, size_t count, uint32_t cyclesPerFrame)
+    : cyclesPerFrame(cyclesPerFrame), count(count) {
+    // The Chip8s, then the prototype state, in one block rounded up to the 64 bytes both need
+    block = std::malloc(count * sizeof(Chip8) + sizeof(Chip8State) + 63u);
+
+    if (!block) {
+        throw std::bad_alloc();
+    }
+
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(block) + 63u) & ~static_cast<uintptr_t>(63u);
+    machines = reinterpret_cast<Chip8*>(aligned);
+    initial = new (machines + count) Chip8State(prototype.State());
+
+    for (size_t env = 0; env < count; ++env) {
+        Chip8* machine = new (machines + env) Chip8();
+
+        machine->SetQuirks(prototype.quirks);
+        machine->engine = prototype.engine;
+        machine->skipIdle = prototype.skipIdle;
+        machine->romHash = prototype.romHash;
+        machine->romSize = prototype.romSize;
+        machine->SetState(*initial);
+    }
+}
+
+VectorEnv::~VectorEnv() {
+    for (size_t env = 0; env < count; ++env) {
+        machines[env].~Chip8();
+    }
+
+    initial->~Chip8State();
+    std::free(block);
+}
+
+void VectorEnv::Reset(uint64_t const* seeds) {
+    for (size_t env = 0; env < count; ++env) {
+        Chip8& machine = machines[env];
+
+        machine.SetState(*initial);
+        machine.Seed(seeds[env]);
+        machine.skippedCycles = 0;
+    }
+    /*
+    - SetState() only drops decoded code where memory differs, so a reset keeps most of the decode cache
+    */
+}
+
+void VectorEnv::Step(uint16_t const* actions) {
+    for (size_t env = 0; env < count; ++env) {
+        Chip8& machine = machines[env];
+
+        for (unsigned int key = 0; key < 16; ++key) {
+            machine.keypad[key] = (actions[env] >> key) & 1u;
+        }
+
+        machine.Run(cyclesPerFrame);
+    }
+}
+
+Observation VectorEnv::Observe() const {
+    Observation observation;
+    observation.first = reinterpret_cast<uint8_t const*>(machines[0].video);
+    observation.stride = sizeof(Chip8);
+    observation.count = count;
+    return observation;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "chip8.h"
+#include <cstddef>
+#include <cstdint>
+
+/*
+Vectorized environment: count independent Chip8s of one ROM driven as a single environment for agent training
+
+- Reset(seeds) puts every emulator back to the prototype's state with its own RNG seed
+- Step(actions) holds the keys of each emulator's action mask and runs every emulator for one frame
+- Observe() hands out the framebuffers where the emulators draw them, nothing is copied or converted
+- the emulators, and the prototype state Reset() goes back to, are one block allocated by the constructor,
+  so Reset(), Step() and Observe() never allocate
+
+Frames are the packed framebuffer of Chip8State: VIDEO_HEIGHT rows of one uint64_t, the leftmost pixel in
+the highest bit, 256 bytes per emulator.
+*/
+
+// Every emulator's framebuffer in place, valid until the next Step() or Reset()
+struct Observation {
+    uint8_t const* first;
+    size_t stride;   // bytes from one emulator's frame to the next one's
+    size_t count;
+
+    uint64_t const* operator[](size_t env) const {
+        return reinterpret_cast<uint64_t const*>(first + env * stride);
+    }
+};
+
+class VectorEnv {
+    public:
+        // count copies of the prototype's state, quirk profile and engine, each frame runs cyclesPerFrame cycles
+        VectorEnv(Chip8 const& prototype, size_t count, uint32_t cyclesPerFrame);
+        ~VectorEnv();
+
+        VectorEnv(VectorEnv const&) = delete;
+        VectorEnv& operator=(VectorEnv const&) = delete;
+
+        // seeds holds one seed per emulator
+        void Reset(uint64_t const* seeds);
+
+        // actions holds one keypad mask per emulator, bit k set holds key k down for the whole frame
+        void Step(uint16_t const* actions);
+
+        Observation Observe() const;
+
+        size_t Size() const { return count; }
+
+        // Direct access for anything else (registers, save states); Reset() undoes whatever is changed here
+        Chip8& Env(size_t env) { return machines[env]; }
+
+        uint32_t cyclesPerFrame;
+
+    private:
+        size_t count;
+        void* block;
+        Chip8* machines;
+        Chip8State* initial;
+};
@@ -0,0 +1,170 @@
+#include "video_simd.h"
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CHIP8_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+static bool DrawSpriteScalar(uint64_t* rows, uint8_t const* sprite, unsigned int height, unsigned int xPos) {
+    uint64_t collision = 0;
+
+    for (unsigned int row = 0; row < height; ++row) {
+        uint64_t spriteRow = (static_cast<uint64_t>(sprite[row]) << 56u) >> xPos;
+        collision |= rows[row] & spriteRow;
+        rows[row] ^= spriteRow;
+    }
+
+    return collision != 0;
+}
+
+static void ClearScalar(uint64_t* rows) {
+    memset(rows, 0, 32 * sizeof(uint64_t));
+}
+
+static void ExpandScalar(uint64_t const* rows, uint32_t* pixels) {
+    for (unsigned int y = 0; y < 32; ++y) {
+        uint64_t row = rows[y];
+
+        for (unsigned int x = 0; x < 64; ++x) {
+            // Negating the pixel bit gives 0xFFFFFFFF for on and 0 for off
+            pixels[y * 64 + x] = static_cast<uint32_t>(-static_cast<int32_t>((row >> (63u - x)) & 1u));
+        }
+    }
+}
+
+#ifdef CHIP8_SIMD_X86
+
+static bool DrawSpriteSSE2(uint64_t* rows, uint8_t const* sprite, unsigned int height, unsigned int xPos) {
+    __m128i shift = _mm_cvtsi32_si128(static_cast<int>(xPos));
+    __m128i collision = _mm_setzero_si128();
+    unsigned int row = 0;
+
+    // Two rows per register, every lane shifts by the same x
+    for (; row + 2 <= height; row += 2) {
+        __m128i spriteRows = _mm_set_epi64x(static_cast<long long>(sprite[row + 1]), static_cast<long long>(sprite[row]));
+        spriteRows = _mm_srl_epi64(_mm_slli_epi64(spriteRows, 56), shift);
+
+        __m128i screen = _mm_loadu_si128(reinterpret_cast<__m128i const*>(rows + row));
+        collision = _mm_or_si128(collision, _mm_and_si128(screen, spriteRows));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rows + row), _mm_xor_si128(screen, spriteRows));
+    }
+
+    bool collided = _mm_movemask_epi8(_mm_cmpeq_epi8(collision, _mm_setzero_si128())) != 0xFFFF;
+
+    return DrawSpriteScalar(rows + row, sprite + row, height - row, xPos) || collided;
+}
+
+static void ClearSSE2(uint64_t* rows) {
+    __m128i zero = _mm_setzero_si128();
+
+    for (unsigned int i = 0; i < 32; i += 2) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rows + i), zero);
+    }
+}
+
+static void ExpandSSE2(uint64_t const* rows, uint32_t* pixels) {
+    // One lane per pixel of a nibble, leftmost pixel in the first lane
+    __m128i const masks = _mm_setr_epi32(0x8, 0x4, 0x2, 0x1);
+
+    for (unsigned int y = 0; y < 32; ++y) {
+        uint64_t row = rows[y];
+
+        for (unsigned int x = 0; x < 64; x += 4) {
+            __m128i nibble = _mm_set1_epi32(static_cast<int>((row >> (60u - x)) & 0xFu));
+            __m128i on = _mm_cmpeq_epi32(_mm_and_si128(nibble, masks), masks);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + y * 64 + x), on);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static bool DrawSpriteAVX2(uint64_t* rows, uint8_t const* sprite, unsigned int height, unsigned int xPos) {
+    __m128i shift = _mm_cvtsi32_si128(static_cast<int>(xPos));
+    __m256i collision = _mm256_setzero_si256();
+    unsigned int row = 0;
+
+    // Four sprite bytes widened to four 64-bit lanes, then the same shift and XOR as the scalar loop
+    for (; row + 4 <= height; row += 4) {
+        int32_t bytes;
+        memcpy(&bytes, sprite + row, sizeof(bytes));
+
+        __m256i spriteRows = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(bytes));
+        spriteRows = _mm256_srl_epi64(_mm256_slli_epi64(spriteRows, 56), shift);
+
+        __m256i screen = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(rows + row));
+        collision = _mm256_or_si256(collision, _mm256_and_si256(screen, spriteRows));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rows + row), _mm256_xor_si256(screen, spriteRows));
+    }
+
+    // Leftover rows stay in this function, going back to legacy SSE code with dirty AVX state is slow
+    uint64_t tail = 0;
+
+    for (; row < height; ++row) {
+        uint64_t spriteRow = (static_cast<uint64_t>(sprite[row]) << 56u) >> xPos;
+        tail |= rows[row] & spriteRow;
+        rows[row] ^= spriteRow;
+    }
+
+    return !_mm256_testz_si256(collision, collision) || tail != 0;
+}
+
+__attribute__((target("avx2")))
+static void ClearAVX2(uint64_t* rows) {
+    __m256i zero = _mm256_setzero_si256();
+
+    for (unsigned int i = 0; i < 32; i += 4) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rows + i), zero);
+    }
+}
+
+__attribute__((target("avx2")))
+static void ExpandAVX2(uint64_t const* rows, uint32_t* pixels) {
+    // One lane per pixel of a byte, leftmost pixel in the first lane
+    __m256i const masks = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 0x8, 0x4, 0x2, 0x1);
+
+    for (unsigned int y = 0; y < 32; ++y) {
+        uint64_t row = rows[y];
+
+        for (unsigned int x = 0; x < 64; x += 8) {
+            __m256i byte = _mm256_set1_epi32(static_cast<int>((row >> (56u - x)) & 0xFFu));
+            __m256i on = _mm256_cmpeq_epi32(_mm256_and_si256(byte, masks), masks);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + y * 64 + x), on);
+        }
+    }
+}
+
+#endif
+
+VideoKernels const& GetVideoKernels(SimdLevel level) {
+    static VideoKernels const scalar = {SimdLevel::Scalar, "scalar", DrawSpriteScalar, ClearScalar, ExpandScalar};
+
+#ifdef CHIP8_SIMD_X86
+    static VideoKernels const sse2 = {SimdLevel::SSE2, "sse2", DrawSpriteSSE2, ClearSSE2, ExpandSSE2};
+    static VideoKernels const avx2 = {SimdLevel::AVX2, "avx2", DrawSpriteAVX2, ClearAVX2, ExpandAVX2};
+
+    switch (level) {
+        case SimdLevel::AVX2: return avx2;
+        case SimdLevel::SSE2: return sse2;
+        default: break;
+    }
+#else
+    (void)level;
+#endif
+
+    return scalar;
+}
+
+SimdLevel DetectSimdLevel() {
+#ifdef CHIP8_SIMD_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+
+    return SimdLevel::SSE2;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+VideoKernels const* videoKernels = &GetVideoKernels(DetectSimdLevel());
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+Framebuffer kernels with runtime CPU dispatch
+
+The framebuffer is 32 rows of uint64_t, leftmost pixel in the highest bit. Three paths touch it in bulk:
+- drawSprite: XOR the rows of a Dxyn sprite into the screen and report whether any pixel was turned off
+- clear: 00E0
+- expand: turn the bits into the RGBA8888 pixels the platform uploads, 0xFFFFFFFF for on and 0 for off
+
+Every path has a scalar version that works everywhere, an SSE2 version (always there on x86-64) and an AVX2
+version compiled with a target attribute, so the rest of the program does not need -mavx2. The best one the
+CPU supports is picked once at startup.
+*/
+
+enum class SimdLevel : uint8_t {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+struct VideoKernels {
+    SimdLevel level;
+    char const* name;
+
+    // rows points at the first screen row the sprite touches, height is already clipped to the screen
+    bool (*drawSprite)(uint64_t* rows, uint8_t const* sprite, unsigned int height, unsigned int xPos);
+    void (*clear)(uint64_t* rows);
+    void (*expand)(uint64_t const* rows, uint32_t* pixels);
+};
+
+VideoKernels const& GetVideoKernels(SimdLevel level);
+SimdLevel DetectSimdLevel();
+
+// Used by every Chip8, can be pointed at another level (e.g. for benchmarks) before running anything
+extern VideoKernels const* videoKernels;
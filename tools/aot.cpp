@@ -0,0 +1,468 @@
+#include "chip8.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+chip8-aot: ahead-of-time ROM to C++ recompiler
+
+- follows every path reachable from START_ADDRESS and turns each instruction into a label in one function
+- jumps, calls and skips become gotos, everything that needs a runtime target (00EE, Bnnn, Fx0A) goes through a switch on pc
+- the generated code works on a normal Chip8 object, so memory, registers and the framebuffer stay exactly the same
+- addresses that were not compiled (computed Bnnn targets, code outside the ROM) are run one by one with Chip8::Cycle()
+- when a store changes any compiled instruction the rest of the run falls back to Chip8::Run()
+- the quirk profile is fixed at generation time (--quirks), a Chip8 set to another profile just runs Chip8::Run()
+
+The output declares
+
+    void <Name>(Chip8& chip8, uint32_t cycles);
+    extern const uint64_t <Name>_ROM_HASH;
+
+The function executes the given number of instructions exactly like Chip8::Run(). The hash is the ROM's
+HashROM(), a host linking several compiled ROMs picks the one whose hash is Chip8::romHash after LoadROM().
+It includes chip8.h and links against libchip8.
+*/
+
+static std::string Hex(unsigned int value, int digits)
+{
+	char buffer[16];
+	snprintf(buffer, sizeof(buffer), "0x%0*X", digits, value);
+	return buffer;
+}
+
+static std::string Label(uint16_t address)
+{
+	char buffer[16];
+	snprintf(buffer, sizeof(buffer), "L_%03X", address);
+	return buffer;
+}
+
+static char const* OpName(uint8_t op)
+{
+	static char const* const names[OP_ID_COUNT] = {
+		"OP_ID_NULL", "OP_ID_00E0", "OP_ID_00EE", "OP_ID_1nnn", "OP_ID_2nnn", "OP_ID_3xkk", "OP_ID_4xkk",
+		"OP_ID_5xy0", "OP_ID_6xkk", "OP_ID_7xkk", "OP_ID_8xy0", "OP_ID_8xy1", "OP_ID_8xy2", "OP_ID_8xy3",
+		"OP_ID_8xy4", "OP_ID_8xy5", "OP_ID_8xy6", "OP_ID_8xy7", "OP_ID_8xyE", "OP_ID_9xy0", "OP_ID_Annn",
+		"OP_ID_Bnnn", "OP_ID_Cxkk", "OP_ID_Dxyn", "OP_ID_Ex9E", "OP_ID_ExA1", "OP_ID_Fx07", "OP_ID_Fx0A",
+		"OP_ID_Fx15", "OP_ID_Fx18", "OP_ID_Fx1E", "OP_ID_Fx29", "OP_ID_Fx33", "OP_ID_Fx55", "OP_ID_Fx65"
+	};
+
+	return names[op];
+}
+
+class Compiler
+{
+public:
+	Compiler(std::vector<uint8_t> const& rom, uint8_t quirks) : rom(rom), quirks(quirks)
+	{
+		Chip8::BuildOpTable();
+	}
+
+	void FindCode()
+	{
+		std::vector<uint16_t> work(1, static_cast<uint16_t>(START_ADDRESS));
+
+		while (!work.empty())
+		{
+			uint16_t address = work.back();
+			work.pop_back();
+
+			if (!InRom(address) || code.count(address))
+			{
+				continue;
+			}
+
+			code.insert(address);
+			Instruction ins = At(address);
+
+			switch (ins.op)
+			{
+				case OP_ID_1nnn:
+					work.push_back(ins.nnn());
+					break;
+				case OP_ID_2nnn:
+					work.push_back(ins.nnn());
+					work.push_back(address + 2);
+					break;
+				case OP_ID_3xkk:
+				case OP_ID_4xkk:
+				case OP_ID_5xy0:
+				case OP_ID_9xy0:
+				case OP_ID_Ex9E:
+				case OP_ID_ExA1:
+					work.push_back(address + 2);
+					work.push_back(address + 4);
+					break;
+				case OP_ID_00EE:
+				case OP_ID_Bnnn:
+					// Runtime targets: returns land on the addresses after each 2nnn, Bnnn goes through the interpreter
+					break;
+				default:
+					work.push_back(address + 2);
+					break;
+			}
+		}
+	}
+
+	std::string Generate(std::string const& name, std::string const& romName)
+	{
+		std::ostringstream out;
+
+		out << "// Generated by chip8-aot from " << romName << " for quirk profile " << static_cast<int>(quirks)
+			<< ", do not edit.\n"
+			<< "// " << code.size() << " instructions compiled, link with libchip8.\n\n"
+			<< "#include \"chip8.h\"\n"
+			<< "#include <cstring>\n\n";
+
+		char hash[24];
+		snprintf(hash, sizeof(hash), "0x%016llXull", static_cast<unsigned long long>(HashROM(rom.data(), rom.size())));
+
+		out << "// HashROM() of the ROM compiled here, see Chip8::romHash\n"
+			<< "extern const uint64_t " << name << "_ROM_HASH = " << hash << ";\n\n";
+
+		EmitIntactCheck(out, name);
+
+		out << "void " << name << "(Chip8& chip8, uint32_t cycles)\n"
+			<< "{\n"
+			<< "\tuint8_t* V = chip8.registers;\n"
+			<< "\tuint32_t executed = 0;\n"
+			<< "\tuint32_t ticked = 0;\n"
+			<< "\tuint16_t store;\n\n"
+			<< "\tif (chip8.quirks != " << static_cast<int>(quirks) << " || !" << name << "_Intact(chip8))\n"
+			<< "\t{\n"
+			<< "\t\tchip8.Run(cycles);\n"
+			<< "\t\treturn;\n"
+			<< "\t}\n\n"
+			<< "dispatch:\n"
+			<< "\tswitch (chip8.pc)\n"
+			<< "\t{\n";
+
+		for (std::set<uint16_t>::const_iterator it = code.begin(); it != code.end(); ++it)
+		{
+			out << "\t\tcase " << Hex(*it, 3) << ": goto " << Label(*it) << ";\n";
+		}
+
+		out << "\t\tdefault: break;\n"
+			<< "\t}\n\n"
+			<< "\t// Not compiled, run a single instruction through the interpreter\n"
+			<< "\tif (executed == cycles)\n"
+			<< "\t{\n"
+			<< "\t\tgoto done;\n"
+			<< "\t}\n\n"
+			<< "\tchip8.TickTimers(executed - ticked);\n"
+			<< "\tstore = chip8.index;\n"
+			<< "\tchip8.Cycle();\n"
+			<< "\tticked = ++executed;\n"
+			<< "\tif (" << name << "_Overwritten(chip8, store))\n"
+			<< "\t{\n"
+			<< "\t\tgoto interpret;\n"
+			<< "\t}\n"
+			<< "\tgoto dispatch;\n\n";
+
+		for (std::set<uint16_t>::const_iterator it = code.begin(); it != code.end(); ++it)
+		{
+			EmitInstruction(out, name, *it);
+		}
+
+		out << "interpret:\n"
+			<< "\t// A compiled instruction was overwritten, the interpreter takes over\n"
+			<< "\tchip8.TickTimers(executed - ticked);\n"
+			<< "\tchip8.Run(cycles - executed);\n"
+			<< "\treturn;\n\n"
+			<< "done:\n"
+			<< "\tchip8.TickTimers(executed - ticked);\n"
+			<< "}\n";
+
+		return out.str();
+	}
+
+	std::set<uint16_t> code;
+
+private:
+	std::vector<uint8_t> const& rom;
+	uint8_t quirks;
+
+	bool InRom(uint16_t address) const
+	{
+		return address >= START_ADDRESS && address + 2u <= START_ADDRESS + rom.size();
+	}
+
+	uint16_t Opcode(uint16_t address) const
+	{
+		return (rom[address - START_ADDRESS] << 8u) | rom[address - START_ADDRESS + 1];
+	}
+
+	Instruction At(uint16_t address) const
+	{
+		return Chip8::Decode(Opcode(address));
+	}
+
+	// Jump to a compiled address directly, anywhere else through the interpreter
+	std::string GotoAddress(uint16_t address) const
+	{
+		if (code.count(address))
+		{
+			return "goto " + Label(address) + ";";
+		}
+
+		return "{ chip8.pc = " + Hex(address, 3) + "; goto dispatch; }";
+	}
+
+	void EmitIntactCheck(std::ostringstream& out, std::string const& name)
+	{
+		// Contiguous byte ranges of compiled code, with the bytes they were compiled from
+		std::vector<std::pair<uint16_t, uint16_t>> ranges;
+
+		for (std::set<uint16_t>::const_iterator it = code.begin(); it != code.end(); ++it)
+		{
+			if (!ranges.empty() && *it <= ranges.back().first + ranges.back().second)
+			{
+				ranges.back().second = *it + 2 - ranges.back().first;
+			}
+			else
+			{
+				ranges.push_back(std::make_pair(*it, static_cast<uint16_t>(2)));
+			}
+		}
+
+		out << "static const uint8_t " << name << "_rom[" << rom.size() << "] = {";
+
+		for (size_t i = 0; i < rom.size(); ++i)
+		{
+			out << (i % 16 == 0 ? "\n\t" : " ") << Hex(rom[i], 2) << ",";
+		}
+
+		out << "\n};\n\n"
+			<< "// True while memory still holds the compiled instructions\n"
+			<< "static bool " << name << "_Intact(Chip8 const& chip8)\n"
+			<< "{\n";
+
+		for (size_t i = 0; i < ranges.size(); ++i)
+		{
+			out << "\tif (memcmp(&chip8.memory[" << Hex(ranges[i].first, 3) << "], &" << name << "_rom["
+				<< Hex(ranges[i].first - START_ADDRESS, 3) << "], " << ranges[i].second << ") != 0) return false;\n";
+		}
+
+		// Fx33 and Fx55 store at most 16 bytes from I, the compare only runs when that can reach compiled code
+		out << "\treturn true;\n"
+			<< "}\n\n"
+			<< "static bool " << name << "_Overwritten(Chip8 const& chip8, uint16_t store)\n"
+			<< "{\n"
+			<< "\treturn store < " << Hex(*code.rbegin() + 2, 3) << " && store + 16 > " << Hex(*code.begin(), 3)
+			<< " && !" << name << "_Intact(chip8);\n"
+			<< "}\n\n";
+	}
+
+	void EmitInstruction(std::ostringstream& out, std::string const& name, uint16_t address)
+	{
+		Instruction ins = At(address);
+		std::string x = "V[" + Hex(ins.x, 1) + "]";
+		std::string y = "V[" + Hex(ins.y, 1) + "]";
+		std::string kk = Hex(ins.kk, 2);
+		std::string next = GotoAddress(address + 2);
+		std::string skip = GotoAddress(address + 4);
+
+		std::ostringstream decoded;
+		decoded << "Instruction{" << OpName(ins.op) << ", " << Hex(ins.x, 1) << ", " << Hex(ins.y, 1) << ", " << kk << "}";
+		std::string handlerArgs = "(" + decoded.str() + ");";
+		std::string quirkArgs = "<" + std::to_string(quirks) + ">" + handlerArgs;
+		std::string shifted = (quirks & QUIRK_SHIFT_VY) ? y : x;
+
+		out << Label(address) << ": // " << Hex(Opcode(address), 4) << "\n"
+			<< "\tif (executed == cycles) { chip8.pc = " << Hex(address, 3) << "; goto done; }\n"
+			<< "\t++executed;\n";
+
+		switch (ins.op)
+		{
+			case OP_ID_NULL:
+				break;
+			case OP_ID_00E0:
+				out << "\tchip8.OP_00E0" << handlerArgs << "\n";
+				break;
+			case OP_ID_00EE:
+				out << "\t--chip8.sp;\n"
+					<< "\tchip8.pc = chip8.stack[chip8.sp];\n"
+					<< "\tgoto dispatch;\n\n";
+				return;
+			case OP_ID_1nnn:
+				out << "\t" << GotoAddress(ins.nnn()) << "\n\n";
+				return;
+			case OP_ID_2nnn:
+				out << "\tchip8.stack[chip8.sp] = " << Hex(address + 2, 3) << ";\n"
+					<< "\t++chip8.sp;\n"
+					<< "\t" << GotoAddress(ins.nnn()) << "\n\n";
+				return;
+			case OP_ID_3xkk:
+				out << "\tif (" << x << " == " << kk << ") " << skip << "\n\t" << next << "\n\n";
+				return;
+			case OP_ID_4xkk:
+				out << "\tif (" << x << " != " << kk << ") " << skip << "\n\t" << next << "\n\n";
+				return;
+			case OP_ID_5xy0:
+				out << "\tif (" << x << " == " << y << ") " << skip << "\n\t" << next << "\n\n";
+				return;
+			case OP_ID_9xy0:
+				out << "\tif (" << x << " != " << y << ") " << skip << "\n\t" << next << "\n\n";
+				return;
+			case OP_ID_Ex9E:
+				out << "\tif (chip8.keypad[" << x << " & 0xF]) " << skip << "\n\t" << next << "\n\n";
+				return;
+			case OP_ID_ExA1:
+				out << "\tif (!chip8.keypad[" << x << " & 0xF]) " << skip << "\n\t" << next << "\n\n";
+				return;
+			case OP_ID_6xkk:
+				out << "\t" << x << " = " << kk << ";\n";
+				break;
+			case OP_ID_7xkk:
+				out << "\t" << x << " += " << kk << ";\n";
+				break;
+			case OP_ID_8xy0:
+				out << "\t" << x << " = " << y << ";\n";
+				break;
+			case OP_ID_8xy1:
+				out << "\t" << x << " |= " << y << ";\n";
+				break;
+			case OP_ID_8xy2:
+				out << "\t" << x << " &= " << y << ";\n";
+				break;
+			case OP_ID_8xy3:
+				out << "\t" << x << " ^= " << y << ";\n";
+				break;
+			case OP_ID_8xy4:
+				out << "\t{ uint16_t sum = " << x << " + " << y << "; V[0xF] = sum > 255u; " << x << " = sum & 0xFFu; }\n";
+				break;
+			case OP_ID_8xy5:
+				out << "\tV[0xF] = " << x << " > " << y << ";\n"
+					<< "\t" << x << " -= " << y << ";\n";
+				break;
+			case OP_ID_8xy6:
+				out << "\tV[0xF] = " << shifted << " & 0x1u;\n"
+					<< "\t" << x << " = " << shifted << " >> 1;\n";
+				break;
+			case OP_ID_8xy7:
+				out << "\tV[0xF] = " << y << " > " << x << ";\n"
+					<< "\t" << x << " = " << y << " - " << x << ";\n";
+				break;
+			case OP_ID_8xyE:
+				out << "\tV[0xF] = (" << shifted << " & 0x80u) >> 7u;\n"
+					<< "\t" << x << " = " << shifted << " << 1;\n";
+				break;
+			case OP_ID_Annn:
+				out << "\tchip8.index = " << Hex(ins.nnn(), 3) << ";\n";
+				break;
+			case OP_ID_Bnnn:
+				out << "\tchip8.pc = " << ((quirks & QUIRK_JUMP_VX) ? x : "V[0x0]") << " + " << Hex(ins.nnn(), 3) << ";\n"
+					<< "\tgoto dispatch;\n\n";
+				return;
+			case OP_ID_Fx1E:
+				out << "\tchip8.index += " << x << ";\n";
+				break;
+			case OP_ID_Fx29:
+				out << "\tchip8.index = FONT_START_ADDRESS + (5 * " << x << ");\n";
+				break;
+			case OP_ID_Fx07:
+			case OP_ID_Fx15:
+			case OP_ID_Fx18:
+				// Bring the timers up to date with every instruction before this one
+				out << "\tchip8.TickTimers(executed - 1 - ticked);\n"
+					<< "\tticked = executed - 1;\n"
+					<< "\tchip8.OP_" << (OpName(ins.op) + 6) << handlerArgs << "\n";
+				break;
+			case OP_ID_Fx0A:
+				out << "\tchip8.pc = " << Hex(address + 2, 3) << ";\n"
+					<< "\tchip8.OP_Fx0A" << handlerArgs << "\n"
+					<< "\tif (chip8.pc == " << Hex(address, 3) << ") goto " << Label(address) << ";\n"
+					<< "\t" << next << "\n\n";
+				return;
+			case OP_ID_Fx33:
+			case OP_ID_Fx55:
+				// Fx55 may move I past what it stored, so remember where the store started
+				out << "\tstore = chip8.index;\n"
+					<< "\tchip8.OP_" << (OpName(ins.op) + 6) << (ins.op == OP_ID_Fx55 ? quirkArgs : handlerArgs) << "\n"
+					<< "\tif (" << name << "_Overwritten(chip8, store)) { chip8.pc = " << Hex(address + 2, 3)
+					<< "; goto interpret; }\n";
+				break;
+			case OP_ID_Dxyn:
+			case OP_ID_Fx65:
+				out << "\tchip8.OP_" << (OpName(ins.op) + 6) << quirkArgs << "\n";
+				break;
+			default:
+				out << "\tchip8.OP_" << (OpName(ins.op) + 6) << handlerArgs << "\n";
+				break;
+		}
+
+		out << "\t" << next << "\n\n";
+	}
+};
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> positional;
+	uint8_t quirks = 0;
+
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		std::string option = argv[arg];
+
+		if (option == "--quirks" && arg + 1 < argc)
+		{
+			if (!ParseQuirks(argv[++arg], quirks))
+			{
+				std::cerr << "Unknown quirk profile: " << argv[arg] << "\n";
+				std::exit(EXIT_FAILURE);
+			}
+		}
+		else
+		{
+			positional.push_back(option);
+		}
+	}
+
+	if (positional.size() != 2 && positional.size() != 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <ROM> <Output.cpp> [Name] [--quirks modern|cosmac|schip|xochip|N]\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	char const* romFilename = positional[0].c_str();
+	char const* outputFilename = positional[1].c_str();
+	std::string name = positional.size() == 3 ? positional[2] : "Chip8Aot";
+
+	Chip8 loader;
+	RomStatus status = loader.LoadROM(romFilename);
+
+	if (status != RomStatus::Loaded)
+	{
+		std::cerr << romFilename << " " << RomStatusText(status) << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	std::vector<uint8_t> rom(loader.memory + START_ADDRESS, loader.memory + START_ADDRESS + loader.romSize);
+
+	Compiler compiler(rom, quirks);
+	compiler.FindCode();
+
+	if (compiler.code.empty())
+	{
+		std::cerr << romFilename << " has no instructions to compile\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	std::ofstream output(outputFilename);
+	output << compiler.Generate(name, romFilename);
+
+	if (!output)
+	{
+		std::cerr << "Cannot write " << outputFilename << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	std::cout << romFilename << ": " << compiler.code.size() << " instructions compiled into " << outputFilename << "\n";
+
+	return 0;
+}
@@ -0,0 +1,406 @@
+#include "chip8.h"
+#include "jit_x64.h"
+#include "replay.h"
+#include "rom_db.h"
+#include "rom_index.h"
+#include "work_stealing_pool.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+chip8-batch: run every job of a manifest on all cores and stream one result per job
+
+- the manifest holds one job per line, "<ROM> <Seed> <InputScript|-> <Cycles|Framesf>", paths relative to
+  the working directory and without spaces; blank lines and lines starting with # are ignored
+- jobs run exactly like chip8-headless would run them with the same options, so a single result can be
+  reproduced (and dumped in full) with chip8-headless <ROM> <Budget> <InputScript> --seed <Seed>
+- --rom-db gives every job of a ROM listed there (by content hash, see rom_db.h) that ROM's profile, --quirks
+  still wins when given; --rom-index does the same with the profiles chip8-index guessed, below --rom-db
+- the jobs are spread over a work-stealing pool (--threads, every hardware thread by default), each thread reuses
+  one machine and, with --engine jit, one Jit that is flushed between jobs
+- results are written as each job finishes, so the order is not the manifest order; the line field says
+  which job it was; --format picks csv (with a header line) or jsonl
+- a job that cannot run (missing or oversized ROM, broken input script) still gets a result line, with the reason in
+  status, and makes the exit code non-zero
+
+Each result holds the FNV-1a hash of the framebuffer (see HashVideo), V0 to VF as 32 hex digits, I, PC,
+SP, the timers, the cycle counters and the wall time of the job.
+*/
+
+struct Job
+{
+	int line;
+	std::string rom;
+	uint64_t seed;
+	std::string script;
+	std::string budget;
+};
+
+struct Result
+{
+	std::string status;
+	uint64_t video;
+	Chip8State state;
+	uint64_t skippedCycles;
+	double wallSeconds;
+};
+
+struct Options
+{
+	std::string engine = "interpreter";
+	uint32_t cyclesPerFrame = 10;
+	uint8_t quirks = 0;
+	bool quirksGiven = false;
+	RomDatabase romDb;
+	RomIndex romIndex;
+	bool json = false;
+};
+
+static std::vector<Job> LoadManifest(char const* filename)
+{
+	std::ifstream file(filename);
+
+	if (!file.is_open())
+	{
+		std::cerr << "Cannot open " << filename << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	std::vector<Job> jobs;
+	std::string line;
+	int lineNumber = 0;
+
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+
+		if (line.find_first_not_of(" \t\r") == std::string::npos || line[line.find_first_not_of(" \t")] == '#')
+		{
+			continue;
+		}
+
+		std::istringstream fields(line);
+		Job job;
+		std::string seed;
+		std::string extra;
+		job.line = lineNumber;
+
+		if (!(fields >> job.rom >> seed >> job.script >> job.budget) || (fields >> extra)
+			|| !ParseNumber(seed.c_str(), UINT64_MAX, job.seed))
+		{
+			std::cerr << filename << ":" << lineNumber << ": expected <ROM> <Seed> <InputScript|-> <Cycles|Framesf>\n";
+			std::exit(EXIT_FAILURE);
+		}
+
+		jobs.push_back(job);
+	}
+
+	return jobs;
+}
+
+static Result RunJob(Job const& job, Options const& options)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	Result result = {};
+	uint64_t cycles;
+	std::vector<KeyEvent> events;
+
+	if (!ParseBudget(job.budget, options.cyclesPerFrame, cycles))
+	{
+		result.status = "budget must be <Cycles> or <Frames>f";
+		return result;
+	}
+
+	if (job.script != "-" && !LoadScript(job.script.c_str(), events, result.status))
+	{
+		return result;
+	}
+
+	// Kept by each pool thread from job to job, so --engine jit maps one code buffer (and lists its blocks in
+	// /tmp/perf-<pid>.map) per thread rather than per job
+	static thread_local Chip8 chip8;
+	static thread_local std::unique_ptr<Jit> jit;
+
+	chip8 = Chip8();
+	RomStatus status = chip8.LoadROM(job.rom.c_str());
+
+	if (status != RomStatus::Loaded)
+	{
+		result.status = job.rom + " " + RomStatusText(status);
+		return result;
+	}
+
+	RomInfo const* rom = options.romDb.Find(chip8.romHash);
+	RomIndexEntry const* indexed = options.romIndex.Find(chip8.romHash);
+	uint8_t quirks = options.quirks;
+
+	if (!options.quirksGiven)
+	{
+		quirks = rom ? rom->quirks : indexed ? indexed->quirks : quirks;
+	}
+
+	chip8.instructionsPerSecond = options.cyclesPerFrame * 60;
+	chip8.Seed(job.seed);
+	chip8.SetQuirks(quirks);
+	chip8.engine = options.engine == "block" ? Engine::BasicBlock : Engine::Interpreter;
+
+	if (options.engine == "jit")
+	{
+		if (!jit)
+		{
+			jit.reset(new Jit(chip8));
+		}
+
+		// Nothing translated for the previous job's ROM may run on this one
+		jit->Flush();
+	}
+
+	RunScript(chip8, jit.get(), events, cycles, options.cyclesPerFrame);
+
+	result.status = "ok";
+	result.video = HashVideo(chip8);
+	result.state = chip8.State();
+	result.skippedCycles = chip8.skippedCycles;
+	result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+// Quoted when it has to be (RFC 4180) for csv, always quoted and escaped for JSON
+static std::string Quote(std::string const& text, bool json)
+{
+	if (!json && text.find_first_of(",\"\r\n") == std::string::npos)
+	{
+		return text;
+	}
+
+	std::string quoted = "\"";
+
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		char c = text[i];
+
+		if (c == '"')
+		{
+			quoted += json ? "\\\"" : "\"\"";
+		}
+		else if (json && c == '\\')
+		{
+			quoted += "\\\\";
+		}
+		else if (json && static_cast<unsigned char>(c) < 0x20)
+		{
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			quoted += escaped;
+		}
+		else
+		{
+			quoted += c;
+		}
+	}
+
+	return quoted + "\"";
+}
+
+static std::string Format(Job const& job, Result const& result, bool json)
+{
+	Chip8State const& s = result.state;
+	char registers[33];
+
+	for (int i = 0; i < 16; ++i)
+	{
+		snprintf(registers + 2 * i, 3, "%02x", s.registers[i]);
+	}
+
+	char numbers[256];
+
+	if (json)
+	{
+		snprintf(numbers, sizeof(numbers),
+			"\"video\":\"%016llx\",\"registers\":\"%s\",\"i\":%u,\"pc\":%u,\"sp\":%u,\"dt\":%u,\"st\":%u,"
+			"\"cycles\":%llu,\"skipped\":%llu,\"wall_us\":%.0f}",
+			static_cast<unsigned long long>(result.video), registers, s.index, s.pc, s.sp, s.delayTimer, s.soundTimer,
+			static_cast<unsigned long long>(s.elapsedCycles), static_cast<unsigned long long>(result.skippedCycles),
+			result.wallSeconds * 1e6);
+
+		return "{\"line\":" + std::to_string(job.line) + ",\"rom\":" + Quote(job.rom, true)
+			+ ",\"seed\":" + std::to_string(job.seed) + ",\"status\":" + Quote(result.status, true) + "," + numbers + "\n";
+	}
+
+	snprintf(numbers, sizeof(numbers), "%016llx,%s,%u,%u,%u,%u,%u,%llu,%llu,%.0f",
+		static_cast<unsigned long long>(result.video), registers, s.index, s.pc, s.sp, s.delayTimer, s.soundTimer,
+		static_cast<unsigned long long>(s.elapsedCycles), static_cast<unsigned long long>(result.skippedCycles),
+		result.wallSeconds * 1e6);
+
+	return std::to_string(job.line) + "," + Quote(job.rom, false) + "," + std::to_string(job.seed) + ","
+		+ Quote(result.status, false) + "," + numbers + "\n";
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> positional;
+	Options options;
+	unsigned int threads = 0;
+	std::string format = "csv";
+	std::string outputName;
+
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		std::string option = argv[arg];
+
+		if (option == "--threads" && arg + 1 < argc)
+		{
+			uint64_t value;
+
+			if (!ParseNumber(argv[++arg], WorkStealingPool::MAX_THREADS, value))
+			{
+				std::cerr << "--threads must be a number up to " << WorkStealingPool::MAX_THREADS << ": "
+					<< argv[arg] << "\n";
+				std::exit(EXIT_FAILURE);
+			}
+
+			threads = static_cast<unsigned int>(value);
+		}
+		else if (option == "--format" && arg + 1 < argc)
+		{
+			format = argv[++arg];
+		}
+		else if (option == "--output" && arg + 1 < argc)
+		{
+			outputName = argv[++arg];
+		}
+		else if (option == "--engine" && arg + 1 < argc)
+		{
+			options.engine = argv[++arg];
+		}
+		else if (option == "--cycles-per-frame" && arg + 1 < argc)
+		{
+			uint64_t value;
+
+			if (!ParseNumber(argv[++arg], MAX_CYCLES_PER_FRAME, value))
+			{
+				std::cerr << "--cycles-per-frame must be a number up to " << MAX_CYCLES_PER_FRAME << ": "
+					<< argv[arg] << "\n";
+				std::exit(EXIT_FAILURE);
+			}
+
+			options.cyclesPerFrame = static_cast<uint32_t>(value);
+		}
+		else if (option == "--quirks" && arg + 1 < argc)
+		{
+			if (!ParseQuirks(argv[++arg], options.quirks))
+			{
+				std::cerr << "Unknown quirk profile: " << argv[arg] << "\n";
+				std::exit(EXIT_FAILURE);
+			}
+
+			options.quirksGiven = true;
+		}
+		else if (option == "--rom-db" && arg + 1 < argc)
+		{
+			std::string error;
+
+			if (!options.romDb.Load(argv[++arg], error))
+			{
+				std::cerr << error << "\n";
+				std::exit(EXIT_FAILURE);
+			}
+		}
+		else if (option == "--rom-index" && arg + 1 < argc)
+		{
+			std::string error;
+
+			if (!options.romIndex.Open(argv[++arg], error))
+			{
+				std::cerr << error << "\n";
+				std::exit(EXIT_FAILURE);
+			}
+		}
+		else
+		{
+			positional.push_back(option);
+		}
+	}
+
+	if (positional.size() != 1)
+	{
+		std::cerr << "Usage: " << argv[0] << " <Manifest> [--threads N] [--format csv|jsonl] [--output File]"
+			<< " [--engine interpreter|block|jit] [--cycles-per-frame N] [--quirks modern|cosmac|schip|xochip|N]"
+			<< " [--rom-db File] [--rom-index File]\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (format != "csv" && format != "jsonl")
+	{
+		std::cerr << "Unknown format: " << format << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (options.engine != "interpreter" && options.engine != "block" && options.engine != "jit")
+	{
+		std::cerr << "Unknown engine: " << options.engine << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (options.cyclesPerFrame == 0)
+	{
+		std::cerr << "CyclesPerFrame must be at least 1\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	options.json = format == "jsonl";
+	std::vector<Job> jobs = LoadManifest(positional[0].c_str());
+
+	std::ofstream outputFile;
+
+	if (!outputName.empty())
+	{
+		outputFile.open(outputName.c_str());
+
+		if (!outputFile.is_open())
+		{
+			std::cerr << "Cannot write " << outputName << "\n";
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	std::ostream& output = outputName.empty() ? std::cout : outputFile;
+
+	if (!options.json)
+	{
+		output << "line,rom,seed,status,video,registers,i,pc,sp,dt,st,cycles,skipped,wall_us\n";
+	}
+
+	WorkStealingPool pool(threads);
+	std::mutex outputLock;
+	size_t failed = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	pool.Run(jobs.size(), [&](size_t index, unsigned int)
+	{
+		Result result = RunJob(jobs[index], options);
+		std::string line = Format(jobs[index], result, options.json);
+
+		// Whole lines, flushed as they come, so a long run can be watched (or cut short) with partial results
+		std::lock_guard<std::mutex> guard(outputLock);
+		output << line << std::flush;
+		failed += result.status != "ok";
+	});
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cerr << jobs.size() << " jobs, " << failed << " failed, " << seconds << " s on "
+		<< pool.Threads() << " threads (" << pool.Steals() << " jobs stolen)\n";
+
+	return failed == 0 && output ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,243 @@
+#include "chip8.h"
+#include "jit_x64.h"
+#include "replay.h"
+#include "rom_db.h"
+#include "rom_index.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+chip8-headless: run a ROM without SDL and print the final machine state
+
+- the budget is a number of cycles ("100000") or of frames ("600f"), a frame is CyclesPerFrame cycles
+- the optional input script holds one event per line, see replay.h for the format
+- the RNG is seeded with --seed (default 0) so the same ROM, budget and script always give the same output
+- --quirks picks the profile the ROM was written for (modern by default), see ParseQuirks()
+- --rom-db looks the ROM up by its content hash (see rom_db.h) and takes its profile unless --quirks is given,
+  --rom-index does the same with the profile chip8-index guessed, the database wins when both know the ROM
+- --load-state starts from a save state instead of power-on (its quirk profile wins), --save-state writes one at the end
+
+The output is the FNV-1a hash of the framebuffer (rows top to bottom, each row most significant byte first)
+followed by the registers, timers, stack and cycle counters.
+*/
+
+static void Dump(Chip8 const& chip8)
+{
+	printf("video %016llx\n", static_cast<unsigned long long>(HashVideo(chip8)));
+
+	for (int i = 0; i < 16; ++i)
+	{
+		printf("V%X %02X%s", i, chip8.registers[i], i % 8 == 7 ? "\n" : "  ");
+	}
+
+	printf("I %03X  PC %03X  SP %X  DT %02X  ST %02X\n", chip8.index, chip8.pc, chip8.sp, chip8.delayTimer, chip8.soundTimer);
+	printf("stack");
+
+	for (int i = 0; i < chip8.sp && i < 16; ++i)
+	{
+		printf(" %03X", chip8.stack[i]);
+	}
+
+	printf("\ncycles %llu  skipped %llu\n",
+		static_cast<unsigned long long>(chip8.elapsedCycles), static_cast<unsigned long long>(chip8.skippedCycles));
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> positional;
+	std::string engineName = "interpreter";
+	uint32_t cyclesPerFrame = 10;
+	uint64_t seed = 0;
+	uint8_t quirks = 0;
+	bool quirksGiven = false;
+	std::string romDbFilename;
+	std::string romIndexFilename;
+	std::string loadState;
+	std::string saveState;
+
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		std::string option = argv[arg];
+
+		if (option == "--engine" && arg + 1 < argc)
+		{
+			engineName = argv[++arg];
+		}
+		else if (option == "--cycles-per-frame" && arg + 1 < argc)
+		{
+			uint64_t value;
+
+			if (!ParseNumber(argv[++arg], MAX_CYCLES_PER_FRAME, value))
+			{
+				std::cerr << "--cycles-per-frame must be a number up to " << MAX_CYCLES_PER_FRAME << ": "
+					<< argv[arg] << "\n";
+				std::exit(EXIT_FAILURE);
+			}
+
+			cyclesPerFrame = static_cast<uint32_t>(value);
+		}
+		else if (option == "--seed" && arg + 1 < argc)
+		{
+			if (!ParseNumber(argv[++arg], UINT64_MAX, seed))
+			{
+				std::cerr << "--seed must be a number: " << argv[arg] << "\n";
+				std::exit(EXIT_FAILURE);
+			}
+		}
+		else if (option == "--load-state" && arg + 1 < argc)
+		{
+			loadState = argv[++arg];
+		}
+		else if (option == "--save-state" && arg + 1 < argc)
+		{
+			saveState = argv[++arg];
+		}
+		else if (option == "--quirks" && arg + 1 < argc)
+		{
+			if (!ParseQuirks(argv[++arg], quirks))
+			{
+				std::cerr << "Unknown quirk profile: " << argv[arg] << "\n";
+				std::exit(EXIT_FAILURE);
+			}
+
+			quirksGiven = true;
+		}
+		else if (option == "--rom-db" && arg + 1 < argc)
+		{
+			romDbFilename = argv[++arg];
+		}
+		else if (option == "--rom-index" && arg + 1 < argc)
+		{
+			romIndexFilename = argv[++arg];
+		}
+		else
+		{
+			positional.push_back(option);
+		}
+	}
+
+	if (positional.size() != 2 && positional.size() != 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <ROM> <Cycles|Framesf> [InputScript]"
+			<< " [--engine interpreter|block|jit] [--cycles-per-frame N] [--seed N]"
+			<< " [--quirks modern|cosmac|schip|xochip|N] [--rom-db File] [--rom-index File]"
+			<< " [--load-state File] [--save-state File]\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (engineName != "interpreter" && engineName != "block" && engineName != "jit")
+	{
+		std::cerr << "Unknown engine: " << engineName << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (cyclesPerFrame == 0)
+	{
+		std::cerr << "CyclesPerFrame must be at least 1\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	uint64_t cycles;
+
+	if (!ParseBudget(positional[1], cyclesPerFrame, cycles))
+	{
+		std::cerr << "Budget must be <Cycles> or <Frames>f: " << positional[1] << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	std::vector<KeyEvent> events;
+	std::string error;
+
+	if (positional.size() == 3 && !LoadScript(positional[2].c_str(), events, error))
+	{
+		std::cerr << error << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	Chip8 chip8;
+	RomStatus status = chip8.LoadROM(positional[0].c_str());
+
+	if (status != RomStatus::Loaded)
+	{
+		std::cerr << positional[0] << " " << RomStatusText(status) << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (!romIndexFilename.empty())
+	{
+		RomIndex romIndex;
+
+		if (!romIndex.Open(romIndexFilename.c_str(), error))
+		{
+			std::cerr << error << "\n";
+			std::exit(EXIT_FAILURE);
+		}
+
+		RomIndexEntry const* indexed = romIndex.Find(chip8.romHash);
+		quirks = indexed && !quirksGiven ? indexed->quirks : quirks;
+	}
+
+	if (!romDbFilename.empty())
+	{
+		RomDatabase romDb;
+
+		if (!romDb.Load(romDbFilename.c_str(), error))
+		{
+			std::cerr << error << "\n";
+			std::exit(EXIT_FAILURE);
+		}
+
+		RomInfo const* rom = romDb.Find(chip8.romHash);
+		quirks = rom && !quirksGiven ? rom->quirks : quirks;
+	}
+
+	chip8.instructionsPerSecond = cyclesPerFrame * 60;
+	chip8.Seed(seed);
+	chip8.SetQuirks(quirks);
+
+	if (!loadState.empty())
+	{
+		std::ifstream file(loadState.c_str(), std::ios::binary);
+		std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		if (!chip8.LoadState(buffer.data(), buffer.size()))
+		{
+			std::cerr << loadState << " is not a valid save state of this version\n";
+			std::exit(EXIT_FAILURE);
+		}
+	}
+	chip8.engine = engineName == "block" ? Engine::BasicBlock : Engine::Interpreter;
+
+	std::unique_ptr<Jit> jit;
+
+	if (engineName == "jit")
+	{
+		jit.reset(new Jit(chip8));
+	}
+
+	RunScript(chip8, jit.get(), events, cycles, cyclesPerFrame);
+
+	Dump(chip8);
+
+	if (!saveState.empty())
+	{
+		std::vector<char> buffer(SAVE_STATE_SIZE);
+		chip8.SaveState(buffer.data());
+
+		std::ofstream file(saveState.c_str(), std::ios::binary);
+		file.write(buffer.data(), buffer.size());
+
+		if (!file)
+		{
+			std::cerr << "Cannot write " << saveState << "\n";
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	return 0;
+}
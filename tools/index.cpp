@@ -0,0 +1,377 @@
+#include "chip8.h"
+#include "rom_index.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+/*
+chip8-index: scan ROM libraries on all cores and write a ROM index (see rom_index.h)
+
+- every file below the given directories named *.ch8, *.c8, *.sc8 or *.xo8 is a ROM (--all takes any file),
+  symlinks to files count, symlinks to directories are not followed
+- each ROM gets its content hash, size, histogram of reachable instructions, SUPER-CHIP/XO-CHIP usage and a
+  guessed quirk profile, see AnalyzeROM()
+- the ROMs are read and analysed on a work-stealing pool (--threads, every hardware thread by default)
+- the index being replaced is the cache of the new one: a ROM whose path, size and mtime did not change keeps
+  its entry and is not read again
+- the new index holds exactly what this scan found, ROMs that are gone lose their entries
+- it replaces the old index with rename(), programs that have the old one mapped keep reading it
+- paths are stored the way they were found, relative to the working directory for relative directories
+- with no directories the index is listed instead, one ROM per line, --opcodes adds each ROM's histogram
+
+chip8-headless and chip8-batch take the index with --rom-index and run an indexed ROM with its profile.
+*/
+
+struct RomFile
+{
+	std::string path;
+	uint32_t size;
+	int64_t modified;
+};
+
+static char const* ClassName(unsigned int op)
+{
+	static char const* const names[ROM_OP_CLASSES] = {
+		"unknown", "00E0", "00EE", "1nnn", "2nnn", "3xkk", "4xkk", "5xy0", "6xkk", "7xkk", "8xy0", "8xy1", "8xy2",
+		"8xy3", "8xy4", "8xy5", "8xy6", "8xy7", "8xyE", "9xy0", "Annn", "Bnnn", "Cxkk", "Dxyn", "Ex9E", "ExA1",
+		"Fx07", "Fx0A", "Fx15", "Fx18", "Fx1E", "Fx29", "Fx33", "Fx55", "Fx65",
+		"0nnn", "00Cn", "00FB/C", "00FD", "00FE/F", "Dxy0", "Fx30", "Fx75/85",
+		"00Dn", "5xy2/3", "F000", "Fn01", "F002/x3A"
+	};
+
+	return names[op];
+}
+
+static bool IsRomName(std::string const& name)
+{
+	static char const* const extensions[] = {".ch8", ".c8", ".sc8", ".xo8"};
+
+	for (char const* extension : extensions)
+	{
+		size_t length = strlen(extension);
+
+		if (name.size() > length && strcasecmp(name.c_str() + name.size() - length, extension) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void Scan(std::string const& directory, bool all, std::vector<RomFile>& files, size_t& skipped)
+{
+	DIR* dir = opendir(directory.c_str());
+
+	if (!dir)
+	{
+		std::cerr << "Cannot open " << directory << "\n";
+		return;
+	}
+
+	while (dirent* item = readdir(dir))
+	{
+		std::string name = item->d_name;
+
+		if (name == "." || name == "..")
+		{
+			continue;
+		}
+
+		std::string path = directory + "/" + name;
+		struct stat info;
+
+		if (lstat(path.c_str(), &info) != 0)
+		{
+			continue;
+		}
+
+		if (S_ISLNK(info.st_mode) && (stat(path.c_str(), &info) != 0 || S_ISDIR(info.st_mode)))
+		{
+			continue;
+		}
+
+		if (S_ISDIR(info.st_mode))
+		{
+			Scan(path, all, files, skipped);
+		}
+		else if (S_ISREG(info.st_mode) && (all || IsRomName(name)))
+		{
+			// Empty files and files larger than any CHIP-8 address space are not ROMs
+			if (info.st_size == 0 || static_cast<uint64_t>(info.st_size) > MAX_INDEXED_ROM_SIZE)
+			{
+				++skipped;
+				continue;
+			}
+
+			RomFile file;
+			file.path = path;
+			file.size = static_cast<uint32_t>(info.st_size);
+			file.modified = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+			files.push_back(file);
+		}
+	}
+
+	closedir(dir);
+}
+
+// False when the file cannot be read or no longer has the size it was scanned with
+static bool ReadRom(RomFile const& file, std::vector<uint8_t>& data)
+{
+	int descriptor = open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+
+	if (descriptor < 0)
+	{
+		return false;
+	}
+
+	data.resize(file.size + 1u);
+	size_t loaded = 0;
+	ssize_t count;
+
+	// One byte more than expected, to notice a file that grew
+	while ((count = read(descriptor, data.data() + loaded, data.size() - loaded)) > 0)
+	{
+		loaded += static_cast<size_t>(count);
+	}
+
+	close(descriptor);
+	return count == 0 && loaded == file.size;
+}
+
+static bool WriteIndex(std::string const& filename, std::vector<RomFile> const& files,
+	std::vector<RomIndexEntry>& entries, std::vector<char> const& indexed)
+{
+	std::vector<size_t> order;
+
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		if (indexed[i])
+		{
+			order.push_back(i);
+		}
+	}
+
+	// By hash for RomIndex::Find(), copies of one ROM by path
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+	{
+		return entries[a].hash != entries[b].hash ? entries[a].hash < entries[b].hash : files[a].path < files[b].path;
+	});
+
+	std::string paths;
+
+	for (size_t i : order)
+	{
+		entries[i].path = static_cast<uint32_t>(paths.size());
+		paths += files[i].path;
+		paths += '\0';
+	}
+
+	RomIndexHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "C8IX", 4);
+	header.version = ROM_INDEX_VERSION;
+	header.entryBytes = sizeof(RomIndexEntry);
+	header.count = static_cast<uint32_t>(order.size());
+	header.pathBytes = static_cast<uint32_t>(paths.size());
+
+	std::string temporary = filename + ".tmp";
+	std::ofstream file(temporary.c_str(), std::ios::binary);
+	file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+	for (size_t i : order)
+	{
+		file.write(reinterpret_cast<char const*>(&entries[i]), sizeof(RomIndexEntry));
+	}
+
+	file.write(paths.data(), paths.size());
+	file.close();
+
+	if (!file || rename(temporary.c_str(), filename.c_str()) != 0)
+	{
+		unlink(temporary.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+static void List(RomIndex const& index, bool opcodes)
+{
+	for (size_t i = 0; i < index.Size(); ++i)
+	{
+		RomIndexEntry const& entry = index.Entry(i);
+		char features[6] = {
+			(entry.features & ROM_FITS) ? 'F' : '-',
+			(entry.features & ROM_USES_SCHIP) ? 'S' : '-',
+			(entry.features & ROM_USES_XOCHIP) ? 'X' : '-',
+			(entry.features & ROM_SHIFTS_VY) ? 'V' : '-',
+			(entry.features & ROM_REUSES_I) ? 'I' : '-',
+			'\0'
+		};
+
+		printf("%016llx %5u %5u %2u %s %s\n", static_cast<unsigned long long>(entry.hash), entry.size,
+			entry.instructions, entry.quirks, features, index.Path(entry));
+
+		if (opcodes)
+		{
+			for (unsigned int op = 0; op < ROM_OP_CLASSES; ++op)
+			{
+				if (entry.histogram[op])
+				{
+					printf(" %s:%u", ClassName(op), entry.histogram[op]);
+				}
+			}
+
+			printf("\n");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> positional;
+	unsigned int threads = 0;
+	bool all = false;
+	bool opcodes = false;
+
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		std::string option = argv[arg];
+
+		if (option == "--threads" && arg + 1 < argc)
+		{
+			uint64_t value;
+
+			if (!ParseNumber(argv[++arg], WorkStealingPool::MAX_THREADS, value))
+			{
+				std::cerr << "--threads must be a number up to " << WorkStealingPool::MAX_THREADS << ": "
+					<< argv[arg] << "\n";
+				std::exit(EXIT_FAILURE);
+			}
+
+			threads = static_cast<unsigned int>(value);
+		}
+		else if (option == "--all")
+		{
+			all = true;
+		}
+		else if (option == "--opcodes")
+		{
+			opcodes = true;
+		}
+		else
+		{
+			positional.push_back(option);
+		}
+	}
+
+	if (positional.empty())
+	{
+		std::cerr << "Usage: " << argv[0] << " <Index> [Directory]... [--threads N] [--all] [--opcodes]\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	std::string indexName = positional[0];
+	RomIndex previous;
+	std::string error;
+	bool havePrevious = previous.Open(indexName.c_str(), error);
+
+	if (positional.size() == 1)
+	{
+		if (!havePrevious)
+		{
+			std::cerr << error << "\n";
+			std::exit(EXIT_FAILURE);
+		}
+
+		List(previous, opcodes);
+		return 0;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<RomFile> files;
+	size_t skipped = 0;
+
+	for (size_t i = 1; i < positional.size(); ++i)
+	{
+		std::string directory = positional[i];
+
+		while (directory.size() > 1 && directory.back() == '/')
+		{
+			directory.pop_back();
+		}
+
+		Scan(directory, all, files, skipped);
+	}
+
+	// Overlapping directories find the same files twice
+	std::sort(files.begin(), files.end(), [](RomFile const& a, RomFile const& b) { return a.path < b.path; });
+	auto samePath = [](RomFile const& a, RomFile const& b) { return a.path == b.path; };
+	files.erase(std::unique(files.begin(), files.end(), samePath), files.end());
+
+	std::unordered_map<std::string, RomIndexEntry const*> known;
+
+	for (size_t i = 0; havePrevious && i < previous.Size(); ++i)
+	{
+		known[previous.Path(previous.Entry(i))] = &previous.Entry(i);
+	}
+
+	WorkStealingPool pool(threads);
+	std::vector<std::vector<uint8_t>> buffers(pool.Threads());
+	std::vector<RomIndexEntry> entries(files.size());
+	std::vector<char> indexed(files.size());
+	std::vector<char> reused(files.size());
+
+	pool.Run(files.size(), [&](size_t index, unsigned int thread)
+	{
+		RomFile const& file = files[index];
+		RomIndexEntry& entry = entries[index];
+		auto old = known.find(file.path);
+
+		if (old != known.end() && old->second->size == file.size && old->second->modified == file.modified)
+		{
+			memcpy(&entry, old->second, sizeof(entry));
+			indexed[index] = reused[index] = 1;
+			return;
+		}
+
+		if (ReadRom(file, buffers[thread]))
+		{
+			AnalyzeROM(buffers[thread].data(), file.size, entry);
+			entry.modified = file.modified;
+			indexed[index] = 1;
+		}
+	});
+
+	size_t count = std::count(indexed.begin(), indexed.end(), 1);
+	size_t unchanged = std::count(reused.begin(), reused.end(), 1);
+
+	if (!WriteIndex(indexName, files, entries, indexed))
+	{
+		std::cerr << "Cannot write " << indexName << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cerr << count << " ROMs indexed (" << unchanged << " unchanged, " << count - unchanged << " analysed, "
+		<< files.size() - count << " unreadable, " << skipped << " skipped), " << seconds << " s on "
+		<< pool.Threads() << " threads\n";
+
+	return 0;
+}
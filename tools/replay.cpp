@@ -0,0 +1,129 @@
+#include "replay.h"
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+bool LoadScript(char const* filename, std::vector<KeyEvent>& events, std::string& error)
+{
+	std::ifstream file(filename);
+
+	if (!file.is_open())
+	{
+		error = std::string("Cannot open ") + filename;
+		return false;
+	}
+
+	events.clear();
+	std::string line;
+	int lineNumber = 0;
+
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+
+		if (line.find_first_not_of(" \t\r") == std::string::npos || line[line.find_first_not_of(" \t")] == '#')
+		{
+			continue;
+		}
+
+		std::istringstream fields(line);
+		KeyEvent event;
+		unsigned long long frame;
+		unsigned int key;
+		unsigned int pressed;
+
+		if (!(fields >> frame >> std::hex >> key >> std::dec >> pressed) || key > 0xF || pressed > 1)
+		{
+			error = std::string(filename) + ":" + std::to_string(lineNumber) + ": expected <frame> <key> <0|1>";
+			return false;
+		}
+
+		event.frame = frame;
+		event.key = static_cast<uint8_t>(key);
+		event.pressed = static_cast<uint8_t>(pressed);
+
+		if (!events.empty() && event.frame < events.back().frame)
+		{
+			error = std::string(filename) + ":" + std::to_string(lineNumber) + ": events must be in frame order";
+			return false;
+		}
+
+		events.push_back(event);
+	}
+
+	return true;
+}
+
+bool ParseBudget(std::string const& text, uint32_t cyclesPerFrame, uint64_t& cycles)
+{
+	if (text.empty() || text[0] < '0' || text[0] > '9')
+	{
+		return false;
+	}
+
+	char* end;
+	errno = 0;
+	cycles = std::strtoull(text.c_str(), &end, 10);
+
+	if (errno == ERANGE)
+	{
+		return false;
+	}
+
+	if (*end == 'f')
+	{
+		if (cyclesPerFrame != 0 && cycles > UINT64_MAX / cyclesPerFrame)
+		{
+			return false;
+		}
+
+		cycles *= cyclesPerFrame;
+		++end;
+	}
+
+	return *end == '\0';
+}
+
+void RunScript(Chip8& chip8, Jit* jit, std::vector<KeyEvent> const& events, uint64_t cycles, uint32_t cyclesPerFrame)
+{
+	size_t nextEvent = 0;
+
+	for (uint64_t frame = 0; cycles > 0; ++frame)
+	{
+		while (nextEvent < events.size() && events[nextEvent].frame <= frame)
+		{
+			chip8.keypad[events[nextEvent].key] = events[nextEvent].pressed;
+			++nextEvent;
+		}
+
+		uint32_t run = cycles < cyclesPerFrame ? static_cast<uint32_t>(cycles) : cyclesPerFrame;
+
+		if (jit)
+		{
+			jit->Run(run);
+		}
+		else
+		{
+			chip8.Run(run);
+		}
+
+		cycles -= run;
+	}
+}
+
+uint64_t HashVideo(Chip8 const& chip8)
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row)
+	{
+		for (int shift = 56; shift >= 0; shift -= 8)
+		{
+			hash ^= (chip8.video[row] >> shift) & 0xFFu;
+			hash *= 0x100000001B3ull;
+		}
+	}
+
+	return hash;
+}
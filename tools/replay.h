@@ -0,0 +1,34 @@
+#pragma once
+
+#include "chip8.h"
+#include "jit_x64.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+Scripted runs shared by the command-line tools (chip8-headless, chip8-batch)
+
+- an input script holds one event per line, "<frame> <key> <0|1>" with the key in hex, applied before that
+  frame runs; blank lines and lines starting with # are ignored
+- a budget is a number of cycles ("100000") or of frames ("600f"), a frame is cyclesPerFrame cycles
+*/
+
+struct KeyEvent
+{
+	uint64_t frame;
+	uint8_t key;
+	uint8_t pressed;
+};
+
+// False with a "file:line: reason" message in error if the script cannot be read
+bool LoadScript(char const* filename, std::vector<KeyEvent>& events, std::string& error);
+
+// False if text is neither "<Cycles>" nor "<Frames>f", or the cycles do not fit in 64 bits
+bool ParseBudget(std::string const& text, uint32_t cyclesPerFrame, uint64_t& cycles);
+
+// Run cycles, frame by frame, applying the events due before each frame; jit may be null
+void RunScript(Chip8& chip8, Jit* jit, std::vector<KeyEvent> const& events, uint64_t cycles, uint32_t cyclesPerFrame);
+
+// FNV-1a of the framebuffer, rows top to bottom, each row most significant byte first
+uint64_t HashVideo(Chip8 const& chip8);
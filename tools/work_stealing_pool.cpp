@@ -0,0 +1,103 @@
+#include "work_stealing_pool.h"
+#include <thread>
+#include <vector>
+
+WorkStealingPool::WorkStealingPool(unsigned int threads) : threads(threads)
+{
+	if (this->threads == 0)
+	{
+		this->threads = std::thread::hardware_concurrency();
+	}
+
+	// hardware_concurrency() may not know
+	if (this->threads == 0)
+	{
+		this->threads = 1;
+	}
+
+	queues.reset(new Queue[this->threads]);
+}
+
+void WorkStealingPool::Run(size_t jobs, std::function<void(size_t, unsigned int)> const& task)
+{
+	for (unsigned int thread = 0; thread < threads; ++thread)
+	{
+		size_t first = jobs * thread / threads;
+		size_t last = jobs * (thread + 1) / threads;
+
+		queues[thread].jobs.clear();
+		queues[thread].stolen = 0;
+
+		for (size_t job = first; job < last; ++job)
+		{
+			queues[thread].jobs.push_back(job);
+		}
+	}
+
+	auto work = [&](unsigned int thread)
+	{
+		size_t job;
+
+		while (Take(thread, job) || Steal(thread, job))
+		{
+			task(job, thread);
+		}
+	};
+
+	std::vector<std::thread> workers;
+
+	for (unsigned int thread = 1; thread < threads; ++thread)
+	{
+		workers.push_back(std::thread(work, thread));
+	}
+
+	// The calling thread is thread 0
+	work(0);
+
+	steals = 0;
+
+	for (unsigned int thread = 1; thread < threads; ++thread)
+	{
+		workers[thread - 1].join();
+	}
+
+	for (unsigned int thread = 0; thread < threads; ++thread)
+	{
+		steals += queues[thread].stolen;
+	}
+}
+
+bool WorkStealingPool::Take(unsigned int thread, size_t& job)
+{
+	Queue& queue = queues[thread];
+	std::lock_guard<std::mutex> guard(queue.lock);
+
+	if (queue.jobs.empty())
+	{
+		return false;
+	}
+
+	job = queue.jobs.front();
+	queue.jobs.pop_front();
+	return true;
+}
+
+bool WorkStealingPool::Steal(unsigned int thread, size_t& job)
+{
+	// Start with the next thread so thieves spread over the victims instead of all picking thread 0
+	for (unsigned int offset = 1; offset < threads; ++offset)
+	{
+		Queue& victim = queues[(thread + offset) % threads];
+		std::lock_guard<std::mutex> guard(victim.lock);
+
+		if (!victim.jobs.empty())
+		{
+			job = victim.jobs.back();
+			victim.jobs.pop_back();
+			++queues[thread].stolen;
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+/*
+Work-stealing pool for the command-line tools that run many independent jobs (chip8-batch)
+
+- Run() splits the job indices into one contiguous range per thread, each thread works through its own
+  range front to back, so neighbouring jobs (often the same ROM) run on the same core
+- a thread whose range is used up steals from the back of another thread's range, so a few slow jobs at
+  the end of one range do not leave the other cores idle
+- jobs never create more jobs, so a thread can stop once every range is empty
+*/
+
+class WorkStealingPool
+{
+public:
+	// Most threads the tools let --threads ask for
+	static const unsigned int MAX_THREADS = 4096;
+
+	// 0 threads = one per hardware thread
+	explicit WorkStealingPool(unsigned int threads = 0);
+
+	// Call task(job, thread) once for every job in [0, jobs), returns when all of them are done
+	void Run(size_t jobs, std::function<void(size_t, unsigned int)> const& task);
+
+	unsigned int Threads() const { return threads; }
+
+	// Jobs a thread took from another thread's range during the last Run()
+	size_t Steals() const { return steals; }
+
+private:
+	struct Queue
+	{
+		std::mutex lock;
+		std::deque<size_t> jobs;
+		size_t stolen;
+
+		// Keeps the locks of neighbouring threads off the same cache line (alignas would need C++17 new)
+		char padding[64];
+	};
+
+	unsigned int threads;
+	size_t steals{};
+	std::unique_ptr<Queue[]> queues;
+
+	bool Take(unsigned int thread, size_t& job);
+	bool Steal(unsigned int thread, size_t& job);
+};